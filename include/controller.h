@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <memory>
+#include <span>
+
 /**
  * @brief Interface for controllers used in the inverted pendulum simulation.
  *
@@ -34,6 +37,23 @@ public:
    * @return The control output computed by the controller.
    */
   virtual double output(double error) = 0;
+  /**
+   * @brief Computes the control output based on the full system state.
+   *
+   * Controllers that need more than the angle error override this method.
+   * The default implementation forwards to output(double).
+   *
+   * @param q Generalized positions, cart position followed by the link
+   * angles.
+   * @param q_dot Generalized velocities, in the same order as q.
+   * @param error The error (difference between reference value and current
+   * state).
+   * @return The control output computed by the controller.
+   */
+  virtual double output(std::span<const double> /*q*/,
+                        std::span<const double> /*q_dot*/, double error) {
+    return output(error);
+  }
   /**
    * @brief Updates the controller parameters dynamically.
    *
@@ -64,6 +84,27 @@ public:
    * @param min The minimum allowed control signal.
    */
   virtual void setClamp(double max, double min) = 0;
+
+  /**
+   * @brief Copies the controller, including its internal state, into target.
+   *
+   * If target already holds a controller of the same type it is assigned in
+   * place, so that repeated copies do not allocate.
+   *
+   * @param target Destination of the copy.
+   */
+  virtual void clone_into(std::unique_ptr<Controller> &target) const = 0;
+
+  /**
+   * @brief Returns the average number of model evaluations per call of
+   * output(), used to budget simulations that run ahead of time.
+   *
+   * Controllers that only evaluate a control law cost nothing beyond the
+   * simulation step and return 0.
+   */
+  virtual double step_cost() const { return 0; }
+
+  virtual ~Controller() = default;
 };
 
 /**
@@ -90,6 +131,8 @@ public:
 
   PIDController();
 
+  using Controller::output;
+
   /**
    * @brief Computes the control output based on the given error.
    *
@@ -130,4 +173,11 @@ public:
    * @param min The minimum allowed control signal.
    */
   void setClamp(double max, double min);
+  /**
+   * @brief Copies the PID controller, including its gains and internal state,
+   * into target.
+   *
+   * @param target Destination of the copy.
+   */
+  void clone_into(std::unique_ptr<Controller> &target) const;
 };
@@ -0,0 +1,119 @@
+/**
+ * @file dynamics.h
+ * @brief Header file for the Cart description and the CartPendulumModel class.
+ *
+ * This file declares the Link and Cart structs, which describe a cart carrying
+ * a chain of N rigid links, and the CartPendulumModel class, which computes
+ * the forward dynamics of that system with the articulated-body algorithm.
+ *
+ * The generalized coordinates are q = (x, phi_1, ..., phi_N): x is the cart
+ * position and phi_k the angle of link k relative to link k-1, link 1 being
+ * measured from the vertical. Positive angles tilt the link towards +x.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Struct containing parameters for a single pendulum link.
+ */
+struct Link {
+  double m = 0.5;           ///< Mass of the link
+  double len = 1;           ///< Pivot point to center of mass
+  double span = 2 * len;    ///< Pivot point to the pivot of the next link
+  double I = m * len * len; ///< Moment of inertia about the center of mass
+};
+
+/**
+ * @brief Struct containing parameters for the cart.
+ */
+struct Cart {
+  double M = 5;                  ///< Mass of cart
+  std::vector<Link> links{{}};   ///< Serial chain of links, at least one
+};
+
+/**
+ * @brief Forward dynamics of a cart with N serial links.
+ *
+ * Accelerations are computed in O(N) with the articulated-body algorithm in
+ * planar spatial algebra, expressed in world coordinates. All scratch storage
+ * is allocated on construction, so evaluating the dynamics never allocates.
+ * A model instance must not be shared between threads.
+ */
+class CartPendulumModel {
+public:
+  using Vec3 = std::array<double, 3>; ///< Planar spatial vector
+  using Mat3 = std::array<Vec3, 3>;   ///< Planar spatial matrix
+
+private:
+  /**
+   * @brief Per body scratch of the articulated-body algorithm.
+   */
+  struct Body {
+    Vec3 S;    ///< Joint motion subspace
+    Vec3 v;    ///< Spatial velocity
+    Vec3 c;    ///< Velocity product acceleration
+    Vec3 pA;   ///< Articulated bias force
+    Vec3 U;    ///< IA * S
+    Mat3 IA;   ///< Articulated inertia
+    double D;  ///< S^T * IA * S
+    double u;  ///< Joint force minus bias
+  };
+
+  Cart m_cart;                ///< Cart and link parameters
+  double m_g;                 ///< Acceleration due to gravity
+  std::vector<Body> m_bodies; ///< Cart followed by the links
+
+public:
+  /**
+   * @brief Constructs the model for a cart description.
+   *
+   * Throws std::invalid_argument if the cart has no links.
+   *
+   * @param cart Cart and link parameters.
+   * @param g Acceleration due to gravity.
+   */
+  CartPendulumModel(const Cart &cart, double g);
+
+  /**
+   * @brief Returns the number of generalized coordinates (links + 1).
+   */
+  std::size_t dof() const { return m_bodies.size(); }
+
+  /**
+   * @brief Returns the cart description of the model.
+   */
+  const Cart &cart() const { return m_cart; }
+
+  /**
+   * @brief Computes the generalized accelerations.
+   *
+   * @param q Generalized positions, dof() entries.
+   * @param q_dot Generalized velocities, dof() entries.
+   * @param F External force on the cart.
+   * @param q_dot_dot Output accelerations, dof() entries.
+   */
+  void accelerations(std::span<const double> q, std::span<const double> q_dot,
+                     double F, std::span<double> q_dot_dot);
+
+  /**
+   * @brief Computes the total mechanical energy, with the potential energy
+   * zero at the height of the cart.
+   *
+   * @param q Generalized positions, dof() entries.
+   * @param q_dot Generalized velocities, dof() entries.
+   * @return Kinetic plus potential energy.
+   */
+  double energy(std::span<const double> q, std::span<const double> q_dot);
+
+private:
+  /**
+   * @brief Computes joint axes, velocities, inertias and bias terms of all
+   * bodies (first pass of the articulated-body algorithm).
+   */
+  void kinematics(std::span<const double> q, std::span<const double> q_dot);
+};
@@ -0,0 +1,277 @@
+/**
+ * @file mppi.h
+ * @brief Header file for the MPPIController class.
+ *
+ * This file declares the MPPIController class, a sampling based model
+ * predictive controller (Model Predictive Path Integral control). Every
+ * control period it rolls out a hundred or more perturbed force sequences on
+ * the cart-pendulum model and averages them, weighted by their cost. All
+ * rollout storage is allocated on construction, so solving never allocates.
+ */
+
+#pragma once
+
+#include "controller.h"
+#include "dynamics.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Struct containing parameters for the MPPI controller.
+ */
+struct MPPIParams {
+  std::size_t samples = 128; ///< Rollouts per solve
+  std::size_t horizon = 25;  ///< Steps per rollout
+  double period = 0.04;      ///< Control period and rollout step in seconds
+  double noise = 20;         ///< Standard deviation of force perturbations
+  double lambda = 1;         ///< Temperature of the cost weighting
+  double max_force = 100;    ///< Upper force limit
+  double min_force = -100;   ///< Lower force limit
+
+  // Cost weights
+  double w_theta = 100;   ///< Link angle error
+  double w_theta_dot = 1; ///< Link angular velocity
+  double w_x = 1;         ///< Cart position
+  double w_x_dot = 1;     ///< Cart velocity
+  double w_force = 0;     ///< Force magnitude
+  double w_terminal = 10; ///< Factor on the cost of the final rollout state
+
+  bool background = false; ///< Solve on a dedicated thread, see MPPIController
+};
+
+/**
+ * @brief Solve time statistics of the MPPI controller.
+ *
+ * Updated by the solving thread and read by the communication server.
+ */
+struct MPPIStats {
+  std::atomic<std::int64_t> last_ns{0}; ///< Duration of the last solve
+  std::atomic<std::int64_t> max_ns{0};  ///< Longest solve since reset
+  std::atomic<std::uint64_t> solves{0}; ///< Number of solves since reset
+  std::atomic<std::uint64_t> misses{0}; ///< Solves longer than the period
+
+  MPPIStats() = default;
+  MPPIStats(const MPPIStats &other) { *this = other; }
+  MPPIStats &operator=(const MPPIStats &other) {
+    last_ns = other.last_ns.load();
+    max_ns = other.max_ns.load();
+    solves = other.solves.load();
+    misses = other.misses.load();
+    return *this;
+  }
+};
+
+/**
+ * @brief Implementation of a sampling based model predictive controller.
+ *
+ * The controller is evaluated once per simulation step and solves once per
+ * control period, applying the planned force sequence in between. It needs
+ * the full state, so output(double) only returns the held force. The
+ * reference angle for the links is recovered from the error passed by the
+ * simulator.
+ *
+ * By default the solve runs inside output(). With MPPIParams::background set,
+ * a solver thread owned by the controller runs it instead: at the start of a
+ * period output() hands the state to the solver and every call picks up the
+ * latest finished plan, both with a try_lock that never waits for the
+ * solver. The plan is indexed by the periods elapsed since its state was
+ * taken, so a late solve does not shift the force sequence. Copies always
+ * solve synchronously, so what-if branches stay deterministic.
+ */
+class MPPIController : public Controller {
+  /**
+   * @brief Rollout model, parameters and preallocated storage of a solver.
+   */
+  struct Planner {
+    MPPIParams params;                       ///< Controller parameters
+    CartPendulumModel model;                 ///< Rollout model
+    std::mt19937 rng{42};                    ///< Perturbation generator
+    std::normal_distribution<double> normal; ///< Standard normal samples
+    std::vector<double> u;         ///< Nominal force sequence, horizon entries
+    std::vector<double> eps;       ///< Perturbations, samples x horizon
+    std::vector<double> cost;      ///< Cost of every rollout
+    std::vector<double> q;         ///< Rollout positions
+    std::vector<double> q_dot;     ///< Rollout velocities
+    std::vector<double> q_dot_dot; ///< Rollout accelerations
+
+    Planner(const MPPIParams &params, const Cart &cart, double g);
+
+    /**
+     * @brief Runs all rollouts and updates the nominal force sequence.
+     *
+     * @param q0 Current generalized positions.
+     * @param q_dot0 Current generalized velocities.
+     * @param ref Reference angle of the links.
+     * @param shift Control periods since the previous solve, the previous
+     * sequence shifted by as many entries is the warm start.
+     */
+    void solve(std::span<const double> q0, std::span<const double> q_dot0,
+               double ref, std::size_t shift);
+  };
+
+  /**
+   * @brief Solver thread and its hand-off with the simulator thread.
+   */
+  struct Background {
+    Planner planner;               ///< Used by the solver thread only
+    std::vector<double> solve_q;   ///< Snapshot being solved, solver only
+    std::vector<double> solve_q_dot; ///< Snapshot being solved, solver only
+
+    std::mutex mutex;                 ///< Guards the hand-off fields below
+    std::condition_variable_any cv;   ///< Signals a new snapshot
+    MPPIParams params;                ///< Parameters for the next solve
+    std::vector<double> q;            ///< Latest state snapshot
+    std::vector<double> q_dot;        ///< Latest velocity snapshot
+    double ref = 0;                   ///< Reference angle of the snapshot
+    std::uint64_t call = 0;           ///< Controller call of the snapshot
+    std::uint64_t epoch = 0;          ///< Incremented by reset()
+    bool pending = false;             ///< Snapshot not picked up yet
+    std::vector<double> ready;        ///< Latest finished plan
+    std::uint64_t ready_call = 0;     ///< Snapshot call of the ready plan
+    std::atomic<bool> fresh{false};   ///< ready not taken by output() yet
+
+    std::jthread thread; ///< Solver thread, declared last to stop first
+
+    explicit Background(const Planner &planner);
+  };
+
+  Planner m_planner;            ///< Solver of the synchronous mode
+  std::uint64_t m_period_steps; ///< Simulation steps per control period
+  std::uint64_t m_calls = 0;    ///< Calls since reset
+  double m_force = 0;           ///< Force of the current step
+  std::vector<double> m_plan;   ///< Applied force sequence, one per period
+  std::uint64_t m_plan_call = 0; ///< Call at which m_plan starts
+  std::unique_ptr<Background> m_background; ///< Null when solving in output()
+
+public:
+  MPPIStats stats; ///< Solve time statistics
+
+  /**
+   * @brief Constructs the controller for a cart and simulation.
+   *
+   * @param cart Cart parameters of the controlled system.
+   * @param sim_dt Time step of the simulation calling the controller.
+   * @param g Acceleration due to gravity.
+   * @param mppi Controller parameters.
+   */
+  MPPIController(const Cart &cart, double sim_dt, double g,
+                 const MPPIParams &mppi = {});
+
+  /**
+   * @brief Copies the controller and its plan, the copy solves synchronously.
+   *
+   * @param other The controller to copy.
+   */
+  MPPIController(const MPPIController &other);
+  /**
+   * @brief Assigns the controller and its plan, stopping the solver thread of
+   * this controller if it has one.
+   *
+   * @param other The controller to copy.
+   */
+  MPPIController &operator=(const MPPIController &other);
+
+  /**
+   * @brief Stops the solver thread.
+   */
+  ~MPPIController();
+
+  using Controller::output;
+
+  /**
+   * @brief Returns the held force, the error alone is not enough to plan.
+   *
+   * @param error The error (difference between reference value and current
+   * state).
+   * @return The force computed by the last solve.
+   */
+  double output(double error);
+  /**
+   * @brief Computes the force on the cart, solving once per control period.
+   *
+   * In background mode this only hands the state to the solver thread at the
+   * start of a period and applies the latest finished plan.
+   *
+   * @param q Generalized positions, cart position followed by the link
+   * angles.
+   * @param q_dot Generalized velocities, in the same order as q.
+   * @param error Current first link angle minus the reference angle.
+   * @return The force on the cart.
+   */
+  double output(std::span<const double> q, std::span<const double> q_dot,
+                double error);
+  /**
+   * @brief Updates the cost weights from gains sent to /pid.
+   *
+   * @param kp Weight of the link angle error.
+   * @param ki Weight of the cart position.
+   * @param kd Weight of the link angular velocity.
+   */
+  void update_params(double kp, double ki, double kd);
+  /**
+   * @brief Clears the force sequence and the statistics.
+   */
+  void reset();
+  /**
+   * @brief Sets the force limits.
+   *
+   * @param max The maximum allowed force.
+   * @param min The minimum allowed force.
+   */
+  void setClamp(double max, double min);
+  /**
+   * @brief Copies the controller, including its force sequence, into target.
+   *
+   * @param target Destination of the copy.
+   */
+  void clone_into(std::unique_ptr<Controller> &target) const;
+
+  /**
+   * @brief Returns the rollout steps per simulation step, one solve of
+   * samples x horizon rollout steps every control period.
+   */
+  double step_cost() const;
+
+  /**
+   * @brief Returns the control deadline in nanoseconds.
+   */
+  std::int64_t deadline_ns() const {
+    return static_cast<std::int64_t>(m_planner.params.period * 1e9);
+  }
+
+private:
+  /**
+   * @brief Solves with planner and returns the solve time in nanoseconds.
+   */
+  std::int64_t timed_solve(Planner &planner, std::span<const double> q,
+                           std::span<const double> q_dot, double ref,
+                           std::size_t shift);
+
+  /**
+   * @brief Records a solve time in stats.
+   *
+   * @param ns Duration of the solve in nanoseconds.
+   */
+  void record_solve(std::int64_t ns);
+
+  /**
+   * @brief Solver thread loop of the background mode.
+   *
+   * @param stop Requested on destruction.
+   */
+  void solver(std::stop_token stop);
+
+  /**
+   * @brief Copies the state of other, shared by copy construction and
+   * assignment.
+   */
+  void assign(const MPPIController &other);
+};
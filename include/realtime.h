@@ -0,0 +1,103 @@
+/**
+ * @file realtime.h
+ * @brief Header file for real-time placement of the simulator and server
+ * threads.
+ *
+ * This file declares the RealtimeConfig struct, selected on the command line,
+ * the RealtimeStatus struct recording which parts of the configuration took
+ * effect, and helpers for CPU pinning, SCHED_FIFO scheduling, memory locking
+ * and prefaulting. Every helper degrades gracefully: when the platform or the
+ * privileges of the process do not allow a setting, the reason is reported on
+ * stderr and the simulation continues with default scheduling.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Requested real-time configuration.
+ */
+struct RealtimeConfig {
+  int sim_cpu = -1;         ///< CPU for the simulator thread, -1 to not pin
+  int io_cpu = -1;          ///< CPU for the server threads, -1 to not pin
+  int sim_priority = 0;     ///< SCHED_FIFO priority of the simulator thread,
+                            ///< 0 keeps the default scheduler
+  bool lock_memory = false; ///< Lock all current and future pages in RAM
+  bool prefault = false;    ///< Touch the simulator stack at startup
+  std::size_t whatif_workers = 0; ///< What-if worker threads, 0 for one per
+                                  ///< CPU available to them
+};
+
+/**
+ * @brief Outcome of applying a RealtimeConfig.
+ *
+ * Written by the configured threads at startup and read by the communication
+ * server.
+ */
+struct RealtimeStatus {
+  std::atomic<bool> sim_pinned{false};    ///< Simulator thread pinned
+  std::atomic<bool> io_pinned{false};     ///< Server thread pinned
+  std::atomic<bool> sim_fifo{false};      ///< Simulator runs SCHED_FIFO
+  std::atomic<bool> memory_locked{false}; ///< mlockall succeeded
+  std::atomic<bool> prefaulted{false};    ///< Simulator stack prefaulted
+};
+
+/**
+ * @brief Pins the calling thread to a CPU.
+ *
+ * @param name Thread name used in the report.
+ * @param cpu CPU index, negative values leave the affinity unchanged.
+ * @return True if the thread was pinned.
+ */
+bool pin_current_thread(const char *name, int cpu);
+
+/**
+ * @brief Switches the calling thread to SCHED_FIFO.
+ *
+ * @param name Thread name used in the report.
+ * @param priority SCHED_FIFO priority, values <= 0 leave the scheduler
+ * unchanged.
+ * @return True if the thread now runs with SCHED_FIFO.
+ */
+bool set_current_thread_fifo(const char *name, int priority);
+
+/**
+ * @brief Keeps the calling worker thread off the simulator and server CPUs.
+ *
+ * Removes sim_cpu and io_cpu from the affinity of the thread, so that the
+ * workers spread over all remaining CPUs. A CPU is kept if it is the last
+ * one the thread may run on. Does nothing if neither CPU is configured.
+ *
+ * @param name Thread name used in the report.
+ * @param rt The real-time configuration.
+ * @return True if the affinity of the thread was changed.
+ */
+bool place_worker_thread(const char *name, const RealtimeConfig &rt);
+
+/**
+ * @brief Returns the number of CPUs worker threads placed with
+ * place_worker_thread() can run on, at least one. Sizes the default
+ * what-if pool.
+ *
+ * @param rt The real-time configuration.
+ */
+std::size_t worker_cpu_count(const RealtimeConfig &rt);
+
+/**
+ * @brief Locks all current and future pages of the process in RAM.
+ *
+ * @return True on success.
+ */
+bool lock_process_memory();
+
+/**
+ * @brief Touches the first 256 KiB of stack of the calling thread so that it
+ * does not page fault later.
+ *
+ * The simulator heap buffers (state, telemetry log, controller storage) are
+ * written when they are constructed, the stack is the only memory of the
+ * simulator thread that is not.
+ */
+void prefault_stack();
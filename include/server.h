@@ -23,9 +23,13 @@
 #include <json.hpp>
 
 #include "controller.h"
+#include "mppi.h"
 #include "simulator.h"
+#include "telemetry.h"
+#include "whatif.h"
 #include <mutex>
 #include <thread>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -52,6 +56,7 @@ class CommServer {
   unsigned short port{8000};             ///< Server Port
   tcp::acceptor
       acceptor; ///< The acceptor is used to listen for incoming connections
+  WhatIfEngine whatif; ///< Evaluates what-if branches of the simulation
 public:
   /**
    * @brief Constructor for CommServer.
@@ -60,8 +65,11 @@ public:
    * for incoming connections on the specified IP address and port.
    *
    * @param sim Reference to the simulator object.
+   * @param rt Real-time configuration, sizes and places the what-if workers.
    */
-  CommServer(Simulator &sim) : sim(sim), acceptor(ioc, {address, port}) {}
+  CommServer(Simulator &sim, const RealtimeConfig &rt = {})
+      : sim(sim), acceptor(ioc, {address, port}),
+        whatif(rt.whatif_workers, 16, 4096, 500000, rt) {}
   /**
    * @brief Starts the communication server.
    *
@@ -87,4 +95,41 @@ private:
    * @param socket The socket for communicating with the client.
    */
   void handle_request(tcp::socket &socket);
+  /**
+   * @brief Sends the recorded trajectory.
+   *
+   * Serves GET /trajectory?from=<step>&max=<samples>. The samples are sent as
+   * a JSON array of objects shaped like the /sim response, or in the binary
+   * telemetry format (see telemetry.h) if the client accepts it.
+   *
+   * @param socket The socket for communicating with the client.
+   * @param req The parsed HTTP request.
+   */
+  void send_trajectory(tcp::socket &socket,
+                       const http::request<http::string_body> &req);
+  /**
+   * @brief Sends an encoded binary telemetry response.
+   *
+   * @param socket The socket for communicating with the client.
+   * @param req The parsed HTTP request.
+   * @param samples The samples to encode.
+   */
+  void send_telemetry(tcp::socket &socket,
+                      const http::request<http::string_body> &req,
+                      const std::vector<TelemetrySample> &samples);
+  /**
+   * @brief Forks the live simulation and sends the predicted branches.
+   *
+   * Serves POST /whatif. The body holds the horizon in seconds, the steps
+   * between trajectory samples and a list of branches, each with optional
+   * gains (kp, ki and kd, all three or none) and reference angle (ref). The
+   * response holds the metrics and sampled trajectory of every branch.
+   * Malformed bodies, sample_every below 1, too many branches and queries
+   * over the work budget of the engine are answered with 400 Bad Request.
+   *
+   * @param socket The socket for communicating with the client.
+   * @param req The parsed HTTP request.
+   */
+  void send_whatif(tcp::socket &socket,
+                   const http::request<http::string_body> &req);
 };
@@ -1,11 +1,12 @@
 /**
  * @file simulator.h
- * @brief Header file for Simulator class, SimParams and Cart.
+ * @brief Header file for Simulator class, SimParams and SimState.
  *
- * This file contains declarations for the simulation parameters struct, Cart
- * Struct and the Simulator class, which are used for simulating the behavior of
- * an inverted pendulum system. It also includes declarations for related data
- * structures and synchronization primitives used in the simulation.
+ * This file contains declarations for the simulation parameters struct, the
+ * simulation state struct and the Simulator class, which are used for
+ * simulating the behavior of an inverted pendulum system. It also includes
+ * declarations for related data structures and synchronization primitives
+ * used in the simulation.
  *
  * @author Utkarsh Raj
  * @date 10-April-2024
@@ -14,12 +15,17 @@
 #pragma once
 
 #include "controller.h"
+#include "dynamics.h"
+#include "realtime.h"
+#include "telemetry.h"
 #include <array>
 #include <atomic>
 #include <cmath>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 /**
  * @brief Struct containing parameters for simulation.
@@ -36,15 +42,62 @@ struct SimParams {
 };
 
 /**
- * @brief Struct containing parameters for the cart.
+ * @brief Struct containing the complete run time state of a simulation.
+ *
+ * The state is kept separate from the Simulator so that it can be advanced
+ * outside of the live simulation loop.
  */
-struct Cart {
-  double M = 5;             ///< Mass of cart
-  double m = 0.5;           ///< Mass of pendulum
-  double len = 1;           ///< Pendum center of mass to pivot point
-  double I = m * len * len; ///< Moment of inertia of pendulum
+struct SimState {
+  static constexpr int buffer_size =
+      100; ///< Size of the circular buffer for storing theta values
+
+  double T = 0;           ///< Current simulation time
+  std::uint64_t step = 0; ///< Number of completed time steps
+  double F = 0;           ///< External force on the cart
+  double E = 0;           ///< Total energy of the system
+  double error = 0; ///< Difference between reference angle and current angle
+
+  std::array<double, buffer_size>
+      theta; ///< Circular buffer to store values of the first link angle
+  int i = 0; ///< Index in circular buffer for theta values
+
+  // Generalized state, index 0 is the cart, index k the link k (see
+  // dynamics.h)
+  std::vector<double> q;         ///< Positions
+  std::vector<double> q_dot;     ///< Velocities
+  std::vector<double> q_dot_dot; ///< Accelerations
+
+  /**
+   * @brief Constructs the initial state for a cart with dof - 1 links.
+   *
+   * @param dof Number of generalized coordinates.
+   */
+  explicit SimState(std::size_t dof = 2)
+      : q(dof, 0), q_dot(dof, 0), q_dot_dot(dof, 0) {
+    reset();
+  }
+
+  /**
+   * @brief Returns the state to the initial conditions without
+   * reallocating.
+   */
+  void reset();
 };
 
+/**
+ * @brief Advances a simulation state by one time step.
+ *
+ * The controller is evaluated on the (delayed) first link angle, then the
+ * state is integrated with the explicit Euler method.
+ *
+ * @param state State to advance.
+ * @param controller Controller computing the force on the cart.
+ * @param params Simulation parameters.
+ * @param model Dynamics of the cart, must match the size of the state.
+ */
+void advance(SimState &state, Controller &controller, const SimParams &params,
+             CartPendulumModel &model);
+
 /**
  * @brief Simulator class for simulating the inverted pendulum.
  */
@@ -54,6 +107,7 @@ public:
   std::unique_ptr<Controller> m_controller; ///< Controller object
   SimParams m_params;                       ///< Simulation Parameters
   Cart m_cart;                              ///< Cart object
+  CartPendulumModel m_model;                ///< Dynamics of the cart
 
   // Synchronization variables between simulator and comm server
   std::atomic<bool> g_start{false}; ///< Flag to start the simulation
@@ -68,46 +122,24 @@ public:
   std::mutex g_pause_mutex; ///< Mutex for Synchronization of simulation pause
                             ///< between simulator and comm server
 
-  // run time variables
-  double T = 0; ///< Current simulation time
-  double F = 0; ///< External force on the cart
+  SimState m_state; ///< Run time state, guarded by g_start_mutex
 
-  // State of the pendulum
-  const int buffer_size =
-      100; ///< Size of the circular buffer for storing theta values
-  std::array<double, 100> theta; ///< Circular buffer to store values of theta
-  std::array<double, 2> theta_dot{
-      0, 0}; ///< Last two angular velocities of the pendulum
-  std::array<double, 2> theta_dot_dot{
-      0, 0}; ///< Last two angular accelerations of the pendulum
-
-  // State of the cart
-  std::array<double, 2> x{0, 0};         ///< Last two positions of the cart
-  std::array<double, 2> x_dot{0, 0};     ///< Last two velocities of the cart
-  std::array<double, 2> x_dot_dot{0, 0}; ///< Last two accelerations of the cart
-
-  // Generic solution to system of two equations
-  const double c_ml = m_cart.m * m_cart.len; ///< Constant term
-  const double B = m_cart.M + m_cart.m;      ///< Constant term
-  const double a =
-      m_cart.I + m_cart.m * std::pow(m_cart.len, 2); ///< Constant term
-
-  // updates every time step
-  double A = 0;     ///< State variable
-  double b = 0;     ///< State variable
-  double C = 0;     ///< State variable
-  double c = 0;     ///< State variable
-  double E = 0;     ///< Total energy of the system
-  double error = 0; ///< Difference between reference angle and current angle
-  int i = 0;        ///< Index in circular buffer for theta values
+  TelemetryLog m_telemetry; ///< Trajectory recorded every time step
+
+  // Real-time behaviour
+  RealtimeStatus m_realtime; ///< Which real-time settings took effect
+  std::atomic<std::int64_t> step_latency_last_ns{
+      0}; ///< Latency of the last time step
+  std::atomic<std::int64_t> step_latency_max_ns{
+      0}; ///< Worst-case latency of a time step since start or reset
 
   /**
-   * @brief Deleted default constructor.
+   * @brief Constructs a Simulator with a PID controller and default
+   * parameters.
    */
-  Simulator() : m_controller(std::make_unique<PIDController>()) {
-    theta.fill(0);
-    theta.at(0) = M_PI_4 / 8;
-  };
+  Simulator()
+      : m_controller(std::make_unique<PIDController>()),
+        m_model(m_cart, m_params.g), m_state(m_model.dof()) {}
 
   /**
    * @brief Constructs a Simulator object with the specified controller,
@@ -116,10 +148,14 @@ public:
    * @param controller Reference to the controller
    * @param params Reference to the simulation parameters
    * @param cart Reference to the cart parameters
+   * @param telemetry_capacity Number of time steps kept in the trajectory log
    */
   Simulator(std::unique_ptr<Controller> controller, const SimParams &params,
-            const Cart &cart)
-      : m_controller(std::move(controller)), m_params(params), m_cart(cart) {}
+            const Cart &cart,
+            std::size_t telemetry_capacity = TelemetryLog::default_capacity)
+      : m_controller(std::move(controller)), m_params(params), m_cart(cart),
+        m_model(m_cart, m_params.g), m_state(m_model.dof()),
+        m_telemetry(telemetry_capacity) {}
   /**
    * @brief Runs the simulator.
    *
@@ -0,0 +1,176 @@
+/**
+ * @file telemetry.h
+ * @brief Header file for the trajectory log and the binary telemetry format.
+ *
+ * This file declares the TelemetryLog ring buffer, which records one sample
+ * per simulation step, together with the encoder and decoder for the compact
+ * binary wire format served on the telemetry endpoints.
+ *
+ * Wire format (all integers are unsigned LEB128 varints unless noted):
+ *
+ *   header  := magic "IPTM" | version:u8 | ncols:u8 | column{ncols} | nsamples
+ *   column  := encoding:u8 | namelen:u8 | name bytes
+ *   sample  := step delta | value{ncols}
+ *
+ * The step of the first sample is absolute, every following step is the
+ * difference to its predecessor. Each value is encoded against the preceding
+ * values of the same column (values before the first sample count as 0.0),
+ * with the encoding stored for the column in the header:
+ *
+ *  - TelemetryEncoding::Xor: the IEEE-754 bit patterns are XORed. A zero XOR
+ *    is written as a single 0x00 byte, otherwise a control byte
+ *    (trailing zero bytes << 4 | significant bytes) is followed by the
+ *    significant bytes in little endian order. Suited for piecewise constant
+ *    columns.
+ *  - TelemetryEncoding::Delta to Delta4: the k-th order finite difference of
+ *    the bit patterns (wrapping 64-bit arithmetic) is written as a zigzag
+ *    varint, i.e. the residual of a polynomial extrapolation of degree k - 1.
+ *    Smooth trajectories integrated with a small time step leave residuals of
+ *    a few bits at k = 3 or 4.
+ *
+ * The encoder picks, per column and per stream, the encoding that yields the
+ * fewest bytes.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// MIME type of the binary telemetry format, selected through the Accept
+/// header.
+inline constexpr std::string_view telemetry_mime =
+    "application/vnd.pendulum.telemetry";
+
+/**
+ * @brief Per column encoding of successive values.
+ */
+enum class TelemetryEncoding : std::uint8_t {
+  Xor = 0,    ///< XOR of bit patterns, Gorilla style
+  Delta = 1,  ///< First order difference of the bit patterns
+  Delta2 = 2, ///< Second order difference (delta of delta)
+  Delta3 = 3, ///< Third order difference
+  Delta4 = 4, ///< Fourth order difference
+};
+
+/// Number of value columns in a telemetry sample.
+inline constexpr std::size_t telemetry_columns = 9;
+
+/// Column names, in the same order and with the same keys as the /sim JSON.
+inline constexpr std::array<std::string_view, telemetry_columns>
+    telemetry_column_names = {"time",      "x",         "theta",
+                              "x_dot",     "theta_dot", "x_dot_dot",
+                              "theta_dot_dot", "force", "energy"};
+
+/**
+ * @brief A single recorded simulation step.
+ */
+struct TelemetrySample {
+  std::uint64_t step = 0; ///< Simulation step index
+  std::array<double, telemetry_columns> values{}; ///< Column values
+};
+
+/**
+ * @brief Fixed capacity ring buffer of telemetry samples.
+ *
+ * The simulator records a sample every time step, the communication server
+ * copies ranges out of it. All storage is allocated on construction so that
+ * recording never allocates. Sample n since the last clear() is stored in
+ * slot n % capacity(), copies take the lock for a bounded chunk at a time so
+ * that recording is never blocked for long.
+ */
+class TelemetryLog {
+  std::vector<TelemetrySample> samples; ///< Ring buffer storage
+  std::uint64_t written = 0;            ///< Samples recorded since clear()
+  std::uint64_t epoch = 0;              ///< Incremented by clear()
+  mutable std::mutex mutex; ///< Guards the buffer between sim and server
+
+public:
+  /// Default capacity, 2^18 samples of 80 bytes (20 MiB). At the 0.1 ms time
+  /// step this is 26 s of simulated time, longer recordings need a larger log
+  /// at 80 MB per million samples.
+  static constexpr std::size_t default_capacity = 1 << 18;
+
+  /**
+   * @brief Constructs a log holding at most capacity samples.
+   *
+   * @param capacity Number of samples kept before the oldest are overwritten.
+   */
+  explicit TelemetryLog(std::size_t capacity = default_capacity);
+
+  /**
+   * @brief Appends a sample, overwriting the oldest one when full.
+   *
+   * @param sample The sample to record.
+   */
+  void record(const TelemetrySample &sample);
+
+  /// Samples copied per lock acquisition in copy_since().
+  static constexpr std::size_t copy_chunk = 1024;
+
+  /**
+   * @brief Copies all samples with a step index of at least from.
+   *
+   * The range is fixed when the call starts and copied in chunks of
+   * copy_chunk samples, releasing the lock in between. Samples that the
+   * recorder overwrites before their chunk is copied are skipped, a clear()
+   * during the copy empties out.
+   *
+   * @param from First step index of interest.
+   * @param out Destination, cleared before copying.
+   * @param max_samples Upper bound on the number of copied samples, the most
+   * recent ones are kept.
+   * @return Number of copied samples.
+   */
+  std::size_t copy_since(std::uint64_t from, std::vector<TelemetrySample> &out,
+                         std::size_t max_samples = SIZE_MAX) const;
+
+  /**
+   * @brief Drops all recorded samples.
+   */
+  void clear();
+
+  /**
+   * @brief Returns the number of samples the log can hold.
+   */
+  std::size_t capacity() const { return samples.size(); }
+};
+
+/**
+ * @brief Encodes samples into the binary telemetry format.
+ *
+ * @param samples Samples ordered by increasing step index.
+ * @return The encoded byte stream.
+ */
+std::string encode_telemetry(const std::vector<TelemetrySample> &samples);
+
+/**
+ * @brief Decoded telemetry stream.
+ */
+struct TelemetryTrace {
+  std::vector<std::string> columns;  ///< Column names from the header
+  std::vector<std::uint64_t> steps;  ///< Step index of every sample
+  std::vector<double> values;        ///< Row major sample values
+
+  /**
+   * @brief Returns the value of column col in sample row.
+   */
+  double at(std::size_t row, std::size_t col) const {
+    return values[row * columns.size() + col];
+  }
+};
+
+/**
+ * @brief Decodes a binary telemetry stream.
+ *
+ * Throws std::runtime_error if the stream is truncated or malformed.
+ *
+ * @param data The encoded byte stream.
+ * @return The decoded trace.
+ */
+TelemetryTrace decode_telemetry(std::string_view data);
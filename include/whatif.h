@@ -0,0 +1,161 @@
+/**
+ * @file whatif.h
+ * @brief Header file for the WhatIfEngine class.
+ *
+ * This file declares the WhatIfEngine class, which forks the live simulation
+ * into branches with candidate controller gains or parameters and runs them
+ * forward in parallel, without touching the live simulation. Branch state is
+ * taken from a pool of preallocated slots so that repeated queries do not
+ * allocate.
+ */
+
+#pragma once
+
+#include "realtime.h"
+#include "simulator.h"
+#include "telemetry.h"
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Candidate changes evaluated by one branch.
+ *
+ * Unset fields keep the value of the live simulation.
+ */
+struct WhatIfBranch {
+  std::optional<std::array<double, 3>> gains; ///< Controller gains kp, ki, kd
+  std::optional<double> ref_angle;            ///< Reference angle
+};
+
+/**
+ * @brief Metrics of a branch over the horizon.
+ */
+struct WhatIfMetrics {
+  double ise = 0;            ///< Integral of the squared angle error
+  double max_abs_error = 0;  ///< Largest absolute angle error
+  double final_error = 0;    ///< Angle error at the end of the horizon
+  double max_abs_x = 0;      ///< Largest absolute cart position
+  double max_abs_force = 0;  ///< Largest absolute force on the cart
+};
+
+/**
+ * @brief Forks the live simulation and evaluates branches in parallel.
+ *
+ * Queries are serialized, the results of a query stay valid until the next
+ * one starts.
+ */
+class WhatIfEngine {
+public:
+  /**
+   * @brief Pooled state of one branch.
+   */
+  struct Slot {
+    SimState state;                          ///< Simulation state
+    SimParams params;                        ///< Simulation parameters
+    std::unique_ptr<Controller> controller;  ///< Copy of the live controller
+    std::optional<CartPendulumModel> model;  ///< Copy of the live dynamics
+    std::vector<TelemetrySample> trajectory; ///< Sampled trajectory
+    WhatIfMetrics metrics;                   ///< Metrics over the horizon
+  };
+
+private:
+  std::size_t m_max_branches;           ///< Number of pooled slots
+  std::size_t m_max_samples;            ///< Trajectory capacity per slot
+  std::uint64_t m_max_work;             ///< Model evaluations per query
+  std::vector<Slot> m_slots;            ///< Branch arena, reused by queries
+  Slot m_base;                          ///< Snapshot of the live simulation
+  std::mutex m_query_mutex;             ///< Serializes queries
+
+  // Work distribution between the query thread and the workers
+  std::mutex m_work_mutex;            ///< Guards the work fields below
+  std::condition_variable m_work_cv;  ///< Signals a new query to the workers
+  std::condition_variable m_done_cv;  ///< Signals finished branches
+  std::uint64_t m_generation = 0;     ///< Incremented for every query
+  std::size_t m_branches = 0;         ///< Branches of the current query
+  std::size_t m_next = 0;             ///< Next unclaimed branch
+  std::size_t m_done = 0;             ///< Finished branches
+  std::uint64_t m_steps = 0;          ///< Horizon in time steps
+  std::uint64_t m_sample_every = 1;   ///< Steps between trajectory samples
+  bool m_stop = false;                ///< Set on destruction
+  std::vector<std::jthread> m_workers; ///< Worker threads
+
+public:
+  /**
+   * @brief Constructs the engine and starts its worker threads.
+   *
+   * @param workers Number of worker threads, 0 for one per CPU available to
+   * them under placement.
+   * @param max_branches Maximum number of branches per query.
+   * @param max_samples Maximum number of trajectory samples per branch.
+   * @param max_work Maximum model evaluations per query, branches x steps x
+   * (1 + Controller::step_cost()), bounds the time a query can take.
+   * @param placement Real-time configuration, the workers are kept off its
+   * simulator and server CPUs.
+   */
+  WhatIfEngine(std::size_t workers = 0, std::size_t max_branches = 16,
+               std::size_t max_samples = 4096,
+               std::uint64_t max_work = 500000,
+               const RealtimeConfig &placement = {});
+
+  /**
+   * @brief Stops the worker threads.
+   */
+  ~WhatIfEngine();
+
+  WhatIfEngine(const WhatIfEngine &) = delete;
+  WhatIfEngine &operator=(const WhatIfEngine &) = delete;
+
+  /**
+   * @brief Returns the maximum number of branches per query.
+   */
+  std::size_t max_branches() const { return m_max_branches; }
+
+  /**
+   * @brief Returns the maximum number of model evaluations per query.
+   */
+  std::uint64_t max_work() const { return m_max_work; }
+
+  /**
+   * @brief Snapshots the live simulation and runs the branches.
+   *
+   * The live simulation is only locked while its state is copied. The
+   * trajectory of each branch is sampled every sample_every steps, the step
+   * interval is increased if the horizon would exceed the sample capacity.
+   * Throws std::invalid_argument if more than max_branches() branches are
+   * requested or the branches would take more than max_work() model
+   * evaluations.
+   *
+   * @param sim The live simulation.
+   * @param branches Candidate changes, one per branch.
+   * @param horizon Simulated time per branch in seconds.
+   * @param sample_every Steps between trajectory samples.
+   * @return The evaluated slots, one per branch, valid until the next query.
+   */
+  std::span<const Slot> run(Simulator &sim,
+                            const std::vector<WhatIfBranch> &branches,
+                            double horizon, std::uint64_t sample_every);
+
+private:
+  /**
+   * @brief Worker thread loop, claims and runs branches of each query.
+   */
+  void worker();
+
+  /**
+   * @brief Runs one branch over the horizon of the current query.
+   *
+   * @param slot The branch to run.
+   * @param steps Number of time steps.
+   * @param sample_every Steps between trajectory samples.
+   */
+  void run_branch(Slot &slot, std::uint64_t steps,
+                  std::uint64_t sample_every);
+};
@@ -31,3 +31,11 @@ void PIDController::reset() {
   ///@todo Implement the reset function for PID controller called by simulator
   /// when simulation is reset
 }
+
+void PIDController::clone_into(std::unique_ptr<Controller> &target) const {
+  if (auto *pid = dynamic_cast<PIDController *>(target.get())) {
+    *pid = *this;
+  } else {
+    target = std::make_unique<PIDController>(*this);
+  }
+}
@@ -0,0 +1,138 @@
+/**
+ * @file dynamics.cpp
+ * @brief Implementation file for the CartPendulumModel class.
+ *
+ * This file contains the articulated-body algorithm for a cart with a serial
+ * chain of links. Planar spatial vectors are (omega, vx, vy) for motions and
+ * (n, fx, fy) for forces, all expressed at the world origin with y pointing
+ * up. Gravity is modelled as an upward acceleration of the fixed base.
+ *
+ */
+
+#include "dynamics.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+using Vec3 = CartPendulumModel::Vec3;
+using Mat3 = CartPendulumModel::Mat3;
+
+double dot(const Vec3 &a, const Vec3 &b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+Vec3 mul(const Mat3 &M, const Vec3 &v) {
+  return {dot(M[0], v), dot(M[1], v), dot(M[2], v)};
+}
+
+/// Spatial cross product for motion vectors, v x m.
+Vec3 crm(const Vec3 &v, const Vec3 &m) {
+  return {0, -v[0] * m[2] + v[2] * m[0], v[0] * m[1] - v[1] * m[0]};
+}
+
+/// Spatial cross product for force vectors, v x* f.
+Vec3 crf(const Vec3 &v, const Vec3 &f) {
+  return {v[1] * f[2] - v[2] * f[1], -v[0] * f[2], v[0] * f[1]};
+}
+
+/// Spatial inertia of a body of mass m with center of mass (cx, cy) and
+/// rotational inertia I about it.
+Mat3 inertia(double m, double cx, double cy, double I) {
+  return {{{I + m * (cx * cx + cy * cy), -m * cy, m * cx},
+           {-m * cy, m, 0},
+           {m * cx, 0, m}}};
+}
+
+} // namespace
+
+CartPendulumModel::CartPendulumModel(const Cart &cart, double g)
+    : m_cart(cart), m_g(g), m_bodies(cart.links.size() + 1) {
+  if (cart.links.empty()) {
+    throw std::invalid_argument("Cart needs at least one link");
+  }
+}
+
+void CartPendulumModel::kinematics(std::span<const double> q,
+                                   std::span<const double> q_dot) {
+  // cart: prismatic joint along x, no rotation
+  Body &cart = m_bodies[0];
+  cart.S = {0, 1, 0};
+  cart.v = {0, q_dot[0], 0};
+  cart.c = {0, 0, 0};
+  cart.IA = inertia(m_cart.M, q[0], 0, 0);
+  cart.pA = crf(cart.v, mul(cart.IA, cart.v));
+
+  double px = q[0], py = 0; // pivot of the current link
+  double phi = 0;           // absolute angle of the current link
+  for (std::size_t k = 1; k < m_bodies.size(); ++k) {
+    const Link &link = m_cart.links[k - 1];
+    Body &b = m_bodies[k];
+    phi += q[k];
+    double s = std::sin(phi), c = std::cos(phi);
+
+    // revolute joint at the pivot, positive angle rotates towards +x (-z)
+    b.S = {-1, -py, px};
+    Vec3 vj = {b.S[0] * q_dot[k], b.S[1] * q_dot[k], b.S[2] * q_dot[k]};
+    const Vec3 &vp = m_bodies[k - 1].v;
+    b.v = {vp[0] + vj[0], vp[1] + vj[1], vp[2] + vj[2]};
+    b.c = crm(b.v, vj);
+    b.IA = inertia(link.m, px + link.len * s, py + link.len * c, link.I);
+    b.pA = crf(b.v, mul(b.IA, b.v));
+
+    px += link.span * s;
+    py += link.span * c;
+  }
+}
+
+void CartPendulumModel::accelerations(std::span<const double> q,
+                                      std::span<const double> q_dot, double F,
+                                      std::span<double> q_dot_dot) {
+  kinematics(q, q_dot);
+
+  // inward pass, accumulate articulated inertias towards the cart
+  for (std::size_t k = m_bodies.size(); k-- > 0;) {
+    Body &b = m_bodies[k];
+    b.U = mul(b.IA, b.S);
+    b.D = dot(b.S, b.U);
+    b.u = (k == 0 ? F : 0) - dot(b.S, b.pA);
+    if (k == 0) {
+      break;
+    }
+    Body &parent = m_bodies[k - 1];
+    Vec3 Ic = mul(b.IA, b.c);
+    for (int r = 0; r < 3; ++r) {
+      for (int col = 0; col < 3; ++col) {
+        double Ia = b.IA[r][col] - b.U[r] * b.U[col] / b.D;
+        parent.IA[r][col] += Ia;
+        // Ia * c, using IA * c computed above
+        Ic[r] -= b.U[r] * b.U[col] / b.D * b.c[col];
+      }
+      parent.pA[r] += b.pA[r] + Ic[r] + b.U[r] * b.u / b.D;
+    }
+  }
+
+  // outward pass, gravity as upward acceleration of the base
+  Vec3 a = {0, 0, m_g};
+  for (std::size_t k = 0; k < m_bodies.size(); ++k) {
+    const Body &b = m_bodies[k];
+    for (int r = 0; r < 3; ++r) {
+      a[r] += b.c[r];
+    }
+    q_dot_dot[k] = (b.u - dot(b.U, a)) / b.D;
+    for (int r = 0; r < 3; ++r) {
+      a[r] += b.S[r] * q_dot_dot[k];
+    }
+  }
+}
+
+double CartPendulumModel::energy(std::span<const double> q,
+                                 std::span<const double> q_dot) {
+  kinematics(q, q_dot);
+  double E = 0;
+  for (const Body &b : m_bodies) {
+    // IA still holds the rigid body inertia, IA[0][1] = -m * cy
+    E += 0.5 * dot(b.v, mul(b.IA, b.v)) - m_g * b.IA[0][1];
+  }
+  return E;
+}
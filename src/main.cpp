@@ -10,31 +10,162 @@
  */
 
 #include "controller.h"
+#include "mppi.h"
+#include "realtime.h"
 #include "server.h"
 #include "simulator.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string>
 #include <thread>
 
+/**
+ * @brief Command line options of the simulator.
+ */
+struct Options {
+  RealtimeConfig rt;     ///< Real-time placement of the threads
+  std::size_t links = 1; ///< Number of pendulum links on the cart
+  bool mppi = false;     ///< Use the MPPI controller instead of PID
+  std::size_t telemetry_samples =
+      TelemetryLog::default_capacity; ///< Capacity of the trajectory log
+};
+
+/**
+ * @brief Parses the integer value of an option.
+ *
+ * Invalid or out of range values are reported and ignored, like unknown
+ * options.
+ *
+ * @param option Name of the option, used in the report.
+ * @param text The value on the command line.
+ * @param value Receives the parsed value, unchanged if text is invalid.
+ * @return True if text was a valid value.
+ */
+template <typename T>
+bool parse_value(const char *option, const char *text, T &value) {
+  T parsed{};
+  const char *end = text + std::strlen(text);
+  auto [ptr, ec] = std::from_chars(text, end, parsed);
+  if (ec != std::errc() || ptr != end) {
+    std::cerr << "Ignoring invalid value " << text << " for " << option
+              << std::endl;
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+/**
+ * @brief Parses the command line.
+ *
+ * Supported options are --links N, --controller pid|mppi,
+ * --telemetry-samples N and the real-time options --sim-cpu N, --io-cpu N,
+ * --sim-priority N, --whatif-workers N, --mlock and --prefault.
+ * Unknown options and invalid values are reported and ignored.
+ *
+ * @param argc Number of arguments.
+ * @param argv Argument vector.
+ * @return The parsed options.
+ */
+Options parse_args(int argc, char *argv[]) {
+  Options opt;
+  RealtimeConfig &rt = opt.rt;
+  for (int k = 1; k < argc; ++k) {
+    bool has_value = k + 1 < argc;
+    if (!std::strcmp(argv[k], "--links") && has_value) {
+      parse_value(argv[k], argv[k + 1], opt.links);
+      opt.links = std::max<std::size_t>(1, opt.links);
+      ++k;
+    } else if (!std::strcmp(argv[k], "--controller") && has_value) {
+      const char *name = argv[++k];
+      if (!std::strcmp(name, "mppi") || !std::strcmp(name, "pid")) {
+        opt.mppi = !std::strcmp(name, "mppi");
+      } else {
+        std::cerr << "Ignoring invalid value " << name << " for " << argv[k - 1]
+                  << std::endl;
+      }
+    } else if (!std::strcmp(argv[k], "--telemetry-samples") && has_value) {
+      parse_value(argv[k], argv[k + 1], opt.telemetry_samples);
+      opt.telemetry_samples = std::max<std::size_t>(1, opt.telemetry_samples);
+      ++k;
+    } else if (!std::strcmp(argv[k], "--sim-cpu") && has_value) {
+      parse_value(argv[k], argv[k + 1], rt.sim_cpu);
+      ++k;
+    } else if (!std::strcmp(argv[k], "--io-cpu") && has_value) {
+      parse_value(argv[k], argv[k + 1], rt.io_cpu);
+      ++k;
+    } else if (!std::strcmp(argv[k], "--sim-priority") && has_value) {
+      parse_value(argv[k], argv[k + 1], rt.sim_priority);
+      ++k;
+    } else if (!std::strcmp(argv[k], "--whatif-workers") && has_value) {
+      parse_value(argv[k], argv[k + 1], rt.whatif_workers);
+      ++k;
+    } else if (!std::strcmp(argv[k], "--mlock")) {
+      rt.lock_memory = true;
+    } else if (!std::strcmp(argv[k], "--prefault")) {
+      rt.prefault = true;
+    } else {
+      std::cerr << "Ignoring unknown option " << argv[k] << std::endl;
+    }
+  }
+  return opt;
+}
+
 /**
  * @brief Main function to start the simulation and communication server.
  *
  * This function initializes the simulator object and
- * communication server. It then starts the simulation and communication
- * server threads, waits for them to finish.
+ * communication server. It then applies the real-time configuration and
+ * starts the simulation and communication server threads, waits for them to
+ * finish.
  *
  * @return 0 on successful completion.
  */
 
-int main() {
+int main(int argc, char *argv[]) {
+
+  Options opt = parse_args(argc, argv);
+  const RealtimeConfig &rt = opt.rt;
+
+  Cart cart;
+  cart.links.resize(opt.links); ///< Identical links, default is one
+
+  SimParams params;
+  std::unique_ptr<Controller> controller;
+  if (opt.mppi) {
+    MPPIParams mppi;
+    mppi.background = true; ///< Keep the solve off the simulator thread
+    controller =
+        std::make_unique<MPPIController>(cart, params.delta_t, params.g, mppi);
+  } else {
+    controller = std::make_unique<PIDController>();
+  }
+
+  Simulator sim(std::move(controller), params, cart,
+                opt.telemetry_samples); ///< Simulator object
+  CommServer comm(sim, rt); ///< Communication server with simulator object
 
-  Simulator sim;        ///< Simulator object
-  CommServer comm(sim); ///< Communication server object with simulator object
+  // lock before prefaulting so that the touched pages stay resident
+  if (rt.lock_memory) {
+    sim.m_realtime.memory_locked = lock_process_memory();
+  }
 
-  std::jthread sim_thread(&Simulator::run_simulator,
-                          std::ref(sim)); ///< Start the simulation thread
+  std::jthread sim_thread([&] {
+    sim.m_realtime.sim_pinned = pin_current_thread("sim", rt.sim_cpu);
+    sim.m_realtime.sim_fifo = set_current_thread_fifo("sim", rt.sim_priority);
+    if (rt.prefault) {
+      prefault_stack();
+      sim.m_realtime.prefaulted = true;
+    }
+    sim.run_simulator();
+  }); ///< Start the simulation thread
 
-  std::jthread comm_thread(
-      &CommServer::start_server,
-      std::ref(comm)); ///< Start the communication server thread
+  std::jthread comm_thread([&] {
+    // the server thread spawned by start_server inherits the affinity
+    sim.m_realtime.io_pinned = pin_current_thread("io", rt.io_cpu);
+    comm.start_server();
+  }); ///< Start the communication server thread
 
   sim_thread.join();
   comm_thread.join(); ///< Wait for the threads to finish
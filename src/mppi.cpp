@@ -0,0 +1,297 @@
+/**
+ * @file mppi.cpp
+ * @brief Implementation file for the MPPIController class.
+ *
+ * This file contains the rollouts, cost evaluation and cost weighted update
+ * of the force sequence of the MPPI controller, and the solver thread with
+ * its hand-off to the simulator thread.
+ *
+ */
+
+#include "mppi.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+MPPIController::Planner::Planner(const MPPIParams &params, const Cart &cart,
+                                 double g)
+    : params(params), model(cart, g), u(params.horizon, 0),
+      eps(params.samples * params.horizon, 0), cost(params.samples, 0),
+      q(model.dof(), 0), q_dot(model.dof(), 0), q_dot_dot(model.dof(), 0) {}
+
+MPPIController::Background::Background(const Planner &planner)
+    : planner(planner), solve_q(planner.model.dof(), 0),
+      solve_q_dot(planner.model.dof(), 0), params(planner.params),
+      q(planner.model.dof(), 0), q_dot(planner.model.dof(), 0),
+      ready(planner.params.horizon, 0) {}
+
+MPPIController::MPPIController(const Cart &cart, double sim_dt, double g,
+                               const MPPIParams &mppi)
+    : m_planner(mppi, cart, g),
+      m_period_steps(std::max<std::uint64_t>(
+          1, static_cast<std::uint64_t>(std::lround(mppi.period / sim_dt)))),
+      m_plan(mppi.horizon, 0) {
+  if (mppi.background) {
+    m_background = std::make_unique<Background>(m_planner);
+    m_background->thread =
+        std::jthread([this](std::stop_token stop) { solver(stop); });
+  }
+}
+
+MPPIController::MPPIController(const MPPIController &other)
+    : m_planner(other.m_planner), m_period_steps(other.m_period_steps) {
+  assign(other);
+}
+
+MPPIController &MPPIController::operator=(const MPPIController &other) {
+  if (this != &other) {
+    m_background.reset();
+    m_planner = other.m_planner;
+    m_period_steps = other.m_period_steps;
+    assign(other);
+  }
+  return *this;
+}
+
+MPPIController::~MPPIController() {
+  // join the solver before the members it uses are destroyed
+  m_background.reset();
+}
+
+void MPPIController::assign(const MPPIController &other) {
+  m_planner.params.background = false;
+  m_calls = other.m_calls;
+  m_force = other.m_force;
+  m_plan = other.m_plan;
+  m_plan_call = other.m_plan_call;
+  stats = other.stats;
+  if (other.m_background && !m_plan.empty()) {
+    // the warm start lives on the solver thread, rebuild it from the plan so
+    // that the next synchronous solve shifts it to the right period
+    const std::uint64_t P = m_period_steps;
+    std::uint64_t next = (m_calls + P - 1) / P * P;
+    std::uint64_t k = (next - std::min(next, m_plan_call)) / P;
+    k = k > 0 ? k - 1 : 0;
+    for (std::size_t h = 0; h < m_planner.u.size(); ++h) {
+      m_planner.u[h] = m_plan[std::min<std::size_t>(k + h, m_plan.size() - 1)];
+    }
+  }
+}
+
+double MPPIController::output(double error) { return m_force; }
+
+double MPPIController::output(std::span<const double> q,
+                              std::span<const double> q_dot, double error) {
+  const bool period_start = m_calls % m_period_steps == 0;
+  if (m_background) {
+    Background &bg = *m_background;
+    if (period_start) {
+      std::unique_lock<std::mutex> lock(bg.mutex, std::try_to_lock);
+      if (lock.owns_lock()) {
+        std::copy(q.begin(), q.end(), bg.q.begin());
+        std::copy(q_dot.begin(), q_dot.end(), bg.q_dot.begin());
+        bg.ref = q[1] - error;
+        bg.call = m_calls;
+        bg.pending = true;
+        lock.unlock();
+        bg.cv.notify_one();
+      }
+    }
+    if (bg.fresh.load(std::memory_order_acquire)) {
+      std::unique_lock<std::mutex> lock(bg.mutex, std::try_to_lock);
+      if (lock.owns_lock() && bg.fresh) {
+        m_plan.swap(bg.ready);
+        m_plan_call = bg.ready_call;
+        bg.fresh = false;
+      }
+    }
+  } else if (period_start) {
+    record_solve(timed_solve(m_planner, q, q_dot, q[1] - error, 1));
+    std::copy(m_planner.u.begin(), m_planner.u.end(), m_plan.begin());
+    m_plan_call = m_calls;
+  }
+
+  if (!m_plan.empty()) {
+    std::uint64_t k = (m_calls - m_plan_call) / m_period_steps;
+    m_force = m_plan[std::min<std::uint64_t>(k, m_plan.size() - 1)];
+  }
+  ++m_calls;
+  return m_force;
+}
+
+std::int64_t MPPIController::timed_solve(Planner &planner,
+                                         std::span<const double> q,
+                                         std::span<const double> q_dot,
+                                         double ref, std::size_t shift) {
+  auto start = std::chrono::steady_clock::now();
+  planner.solve(q, q_dot, ref, shift);
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void MPPIController::record_solve(std::int64_t ns) {
+  stats.last_ns = ns;
+  if (ns > stats.max_ns) {
+    stats.max_ns = ns;
+  }
+  ++stats.solves;
+  if (ns > deadline_ns()) {
+    ++stats.misses;
+  }
+}
+
+void MPPIController::solver(std::stop_token stop) {
+  Background &bg = *m_background;
+  Planner &planner = bg.planner;
+  std::uint64_t epoch = 0, last_call = 0;
+
+  std::unique_lock<std::mutex> lock(bg.mutex);
+  while (bg.cv.wait(lock, stop, [&] { return bg.pending; })) {
+    bg.pending = false;
+    if (bg.epoch != epoch) {
+      // reset() since the last solve, start from an empty sequence
+      epoch = bg.epoch;
+      std::fill(planner.u.begin(), planner.u.end(), 0);
+      last_call = bg.call;
+    }
+    planner.params = bg.params;
+    std::copy(bg.q.begin(), bg.q.end(), bg.solve_q.begin());
+    std::copy(bg.q_dot.begin(), bg.q_dot.end(), bg.solve_q_dot.begin());
+    const double ref = bg.ref;
+    const std::uint64_t call = bg.call;
+    const std::size_t shift = (call - last_call) / m_period_steps;
+    last_call = call;
+
+    lock.unlock();
+    std::int64_t ns =
+        timed_solve(planner, bg.solve_q, bg.solve_q_dot, ref, shift);
+    lock.lock();
+
+    // a solve started before reset() counts neither as plan nor in stats
+    if (bg.epoch == epoch) {
+      record_solve(ns);
+      std::copy(planner.u.begin(), planner.u.end(), bg.ready.begin());
+      bg.ready_call = call;
+      bg.fresh.store(true, std::memory_order_release);
+    }
+  }
+}
+
+void MPPIController::Planner::solve(std::span<const double> q0,
+                                    std::span<const double> q_dot0, double ref,
+                                    std::size_t shift) {
+  const MPPIParams &p = params;
+  const std::size_t H = p.horizon, n = model.dof();
+  const double dt = p.period;
+  if (H == 0 || p.samples == 0) {
+    return;
+  }
+
+  // warm start with the previous solution shifted by the elapsed periods
+  shift = std::min(shift, H - 1);
+  std::rotate(u.begin(), u.begin() + shift, u.end());
+  std::fill(u.end() - shift, u.end(), u[H - 1 - shift]);
+
+  auto state_cost = [&] {
+    double cost = p.w_x * q[0] * q[0] + p.w_x_dot * q_dot[0] * q_dot[0];
+    double phi = 0, phi_dot = 0; // absolute angle and rate of each link
+    for (std::size_t k = 1; k < n; ++k) {
+      phi += q[k];
+      phi_dot += q_dot[k];
+      cost += p.w_theta * (phi - ref) * (phi - ref) +
+              p.w_theta_dot * phi_dot * phi_dot;
+    }
+    return cost;
+  };
+
+  for (std::size_t s = 0; s < p.samples; ++s) {
+    std::copy(q0.begin(), q0.end(), q.begin());
+    std::copy(q_dot0.begin(), q_dot0.end(), q_dot.begin());
+    double *e = &eps[s * H];
+    double c = 0;
+    for (std::size_t h = 0; h < H; ++h) {
+      double F = std::clamp(u[h] + p.noise * normal(rng), p.min_force,
+                            p.max_force);
+      e[h] = F - u[h];
+
+      // semi-implicit Euler, stable at the coarse rollout step
+      model.accelerations(q, q_dot, F, q_dot_dot);
+      for (std::size_t k = 0; k < n; ++k) {
+        q_dot[k] += dt * q_dot_dot[k];
+        q[k] += dt * q_dot[k];
+      }
+      c += state_cost() + p.w_force * F * F +
+           p.lambda * u[h] * e[h] / (p.noise * p.noise);
+    }
+    cost[s] = c + p.w_terminal * state_cost();
+  }
+
+  // exponentially weighted average of the perturbations
+  double min_cost = *std::min_element(cost.begin(), cost.end());
+  double total = 0;
+  for (double &c : cost) {
+    c = std::exp(-(c - min_cost) / p.lambda);
+    total += c;
+  }
+  for (std::size_t s = 0; s < p.samples; ++s) {
+    const double w = cost[s] / total;
+    const double *e = &eps[s * H];
+    for (std::size_t h = 0; h < H; ++h) {
+      u[h] += w * e[h];
+    }
+  }
+  for (double &f : u) {
+    f = std::clamp(f, p.min_force, p.max_force);
+  }
+}
+
+void MPPIController::update_params(double kp, double ki, double kd) {
+  m_planner.params.w_theta = kp;
+  m_planner.params.w_x = ki;
+  m_planner.params.w_theta_dot = kd;
+  if (m_background) {
+    std::lock_guard<std::mutex> lock(m_background->mutex);
+    m_background->params = m_planner.params;
+  }
+}
+
+void MPPIController::reset() {
+  std::unique_lock<std::mutex> lock;
+  if (m_background) {
+    // held until stats are cleared, a solve in flight records under it
+    lock = std::unique_lock<std::mutex>(m_background->mutex);
+    ++m_background->epoch;
+    m_background->pending = false;
+    m_background->fresh = false;
+  }
+  std::fill(m_planner.u.begin(), m_planner.u.end(), 0);
+  std::fill(m_plan.begin(), m_plan.end(), 0);
+  m_plan_call = 0;
+  m_calls = 0;
+  m_force = 0;
+  stats = MPPIStats{};
+}
+
+void MPPIController::setClamp(double max, double min) {
+  m_planner.params.max_force = max;
+  m_planner.params.min_force = min;
+  if (m_background) {
+    std::lock_guard<std::mutex> lock(m_background->mutex);
+    m_background->params = m_planner.params;
+  }
+}
+
+double MPPIController::step_cost() const {
+  return static_cast<double>(m_planner.params.samples *
+                             m_planner.params.horizon) /
+         m_period_steps;
+}
+
+void MPPIController::clone_into(std::unique_ptr<Controller> &target) const {
+  if (auto *mppi = dynamic_cast<MPPIController *>(target.get())) {
+    *mppi = *this;
+  } else {
+    target = std::make_unique<MPPIController>(*this);
+  }
+}
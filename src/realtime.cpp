@@ -0,0 +1,151 @@
+/**
+ * @file realtime.cpp
+ * @brief Implementation file for the real-time thread configuration helpers.
+ *
+ * The helpers use the POSIX/Linux APIs for affinity, scheduling and memory
+ * locking. On other platforms they only report that the setting is not
+ * supported.
+ *
+ */
+
+#include "realtime.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+bool pin_current_thread(const char *name, int cpu) {
+  if (cpu < 0) {
+    return false;
+  }
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err != 0) {
+    std::cerr << "realtime: cannot pin " << name << " thread to CPU " << cpu
+              << ": " << std::strerror(err) << ", leaving it unpinned"
+              << std::endl;
+    return false;
+  }
+  std::cout << "realtime: " << name << " thread pinned to CPU " << cpu
+            << std::endl;
+  return true;
+#else
+  std::cerr << "realtime: CPU pinning not supported on this platform"
+            << std::endl;
+  return false;
+#endif
+}
+
+#ifdef __linux__
+namespace {
+
+/// Removes cpu from set unless it is the last CPU left in it.
+void exclude_cpu(cpu_set_t &set, int cpu) {
+  if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set) &&
+      CPU_COUNT(&set) > 1) {
+    CPU_CLR(cpu, &set);
+  }
+}
+
+} // namespace
+#endif
+
+bool place_worker_thread(const char *name, const RealtimeConfig &rt) {
+  if (rt.sim_cpu < 0 && rt.io_cpu < 0) {
+    return false;
+  }
+#ifdef __linux__
+  cpu_set_t set;
+  int err = pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err == 0) {
+    exclude_cpu(set, rt.sim_cpu);
+    exclude_cpu(set, rt.io_cpu);
+    err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+  if (err != 0) {
+    std::cerr << "realtime: cannot keep " << name
+              << " thread off the sim and io CPUs: " << std::strerror(err)
+              << std::endl;
+    return false;
+  }
+  return true;
+#else
+  std::cerr << "realtime: CPU pinning not supported on this platform"
+            << std::endl;
+  return false;
+#endif
+}
+
+std::size_t worker_cpu_count(const RealtimeConfig &rt) {
+  std::size_t count = std::thread::hardware_concurrency();
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    exclude_cpu(set, rt.sim_cpu);
+    exclude_cpu(set, rt.io_cpu);
+    count = CPU_COUNT(&set);
+  }
+#endif
+  return count > 0 ? count : 1;
+}
+
+bool set_current_thread_fifo(const char *name, int priority) {
+  if (priority <= 0) {
+    return false;
+  }
+#ifdef __linux__
+  sched_param param{};
+  param.sched_priority = priority;
+  int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (err != 0) {
+    std::cerr << "realtime: cannot set SCHED_FIFO priority " << priority
+              << " for " << name << " thread: " << std::strerror(err)
+              << " (needs CAP_SYS_NICE or an rtprio limit), keeping default "
+                 "scheduling"
+              << std::endl;
+    return false;
+  }
+  std::cout << "realtime: " << name << " thread running SCHED_FIFO priority "
+            << priority << std::endl;
+  return true;
+#else
+  std::cerr << "realtime: SCHED_FIFO not supported on this platform"
+            << std::endl;
+  return false;
+#endif
+}
+
+bool lock_process_memory() {
+#ifdef __linux__
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    std::cerr << "realtime: mlockall failed: " << std::strerror(errno)
+              << " (needs CAP_IPC_LOCK or a larger memlock limit), memory "
+                 "stays pageable"
+              << std::endl;
+    return false;
+  }
+  std::cout << "realtime: process memory locked" << std::endl;
+  return true;
+#else
+  std::cerr << "realtime: memory locking not supported on this platform"
+            << std::endl;
+  return false;
+#endif
+}
+
+void prefault_stack() {
+  volatile unsigned char stack[256 * 1024];
+  for (std::size_t k = 0; k < sizeof(stack); k += 4096) {
+    stack[k] = 0;
+  }
+}
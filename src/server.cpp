@@ -9,6 +9,60 @@
  */
 
 #include "server.h"
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Returns true if the request accepts the binary telemetry format.
+ */
+bool accepts_telemetry(const http::request<http::string_body> &req) {
+  return req[http::field::accept].find(
+             {telemetry_mime.data(), telemetry_mime.size()}) !=
+         beast::string_view::npos;
+}
+
+/**
+ * @brief Returns the numeric value of a query parameter, or fallback if absent.
+ */
+std::uint64_t query_param(beast::string_view target, beast::string_view key,
+                          std::uint64_t fallback) {
+  auto q = target.find('?');
+  while (q != beast::string_view::npos) {
+    target.remove_prefix(q + 1);
+    auto end = target.find('&');
+    beast::string_view kv = target.substr(0, end);
+    if (kv.starts_with(key) && kv.size() > key.size() &&
+        kv[key.size()] == '=') {
+      std::uint64_t value = fallback;
+      kv.remove_prefix(key.size() + 1);
+      std::from_chars(kv.data(), kv.data() + kv.size(), value);
+      return value;
+    }
+    q = end;
+  }
+  return fallback;
+}
+
+/**
+ * @brief Converts samples to JSON objects shaped like the /sim response.
+ */
+json samples_to_json(const std::vector<TelemetrySample> &samples) {
+  json trajectory = json::array();
+  for (const auto &s : samples) {
+    json j;
+    j["step"] = s.step;
+    for (std::size_t col = 0; col < telemetry_columns; ++col) {
+      j[std::string(telemetry_column_names[col])] = s.values[col];
+    }
+    trajectory.push_back(std::move(j));
+  }
+  return trajectory;
+}
+
+} // namespace
 
 void CommServer::start_server() {
   std::thread comm_thread(&CommServer::run_server, this);
@@ -32,25 +86,42 @@ void CommServer::handle_request(tcp::socket &socket) {
   http::request<http::string_body> req;
   http::read(socket, buffer, req);
 
+  beast::string_view target = req.target();
+  beast::string_view path = target.substr(0, target.find('?'));
+
   if (req.method() == http::verb::get) {
+    if (path == "/trajectory") {
+      send_trajectory(socket, req);
+      return;
+    }
+    if (path == "/sim" && accepts_telemetry(req)) {
+      std::vector<TelemetrySample> latest;
+      sim.m_telemetry.copy_since(0, latest, 1);
+      send_telemetry(socket, req, latest);
+      return;
+    }
     json j;
     {
-      j["time"] = std::round(sim.T * 100) / 100;
-      j["x"] = std::round(sim.x[0] * 100) / 100;
-      j["theta"] = sim.theta[sim.i];
-      j["x_dot"] = sim.x_dot[0];
-      j["theta_dot"] = sim.theta_dot[0];
-      j["x_dot_dot"] = sim.x_dot_dot[0];
-      j["theta_dot_dot"] = sim.theta_dot_dot[0];
-      j["force"] = sim.F;
-      j["energy"] = sim.E;
+      const SimState &s = sim.m_state;
+      j["time"] = std::round(s.T * 100) / 100;
+      j["x"] = std::round(s.q[0] * 100) / 100;
+      j["theta"] = s.theta[s.i];
+      j["x_dot"] = s.q_dot[0];
+      j["theta_dot"] = s.q_dot[1];
+      j["x_dot_dot"] = s.q_dot_dot[0];
+      j["theta_dot_dot"] = s.q_dot_dot[1];
+      j["force"] = s.F;
+      j["energy"] = s.E;
+      j["q"] = s.q;
+      j["q_dot"] = s.q_dot;
       j["pause"] = sim.g_pause.load();
     }
     std::string response = j.dump();
-    if (req.target() == "/sim") {
+    if (path == "/sim") {
       http::response<http::string_body> res{http::status::ok, req.version()};
       res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
       res.set(http::field::content_type, "application/json");
+      res.set(http::field::vary, "Accept");
 
       res.set(boost::beast::http::field::access_control_allow_origin,
               "*"); // Adjust origin as needed
@@ -67,6 +138,21 @@ void CommServer::handle_request(tcp::socket &socket) {
       json status;
       status["pause"] = sim.g_pause.load();
       status["start"] = sim.g_start.load();
+      status["step_latency_us"] = sim.step_latency_last_ns.load() / 1e3;
+      status["step_latency_max_us"] = sim.step_latency_max_ns.load() / 1e3;
+      status["realtime"] = {
+          {"sim_pinned", sim.m_realtime.sim_pinned.load()},
+          {"io_pinned", sim.m_realtime.io_pinned.load()},
+          {"sim_fifo", sim.m_realtime.sim_fifo.load()},
+          {"memory_locked", sim.m_realtime.memory_locked.load()},
+          {"prefaulted", sim.m_realtime.prefaulted.load()}};
+      if (auto *mppi =
+              dynamic_cast<MPPIController *>(sim.m_controller.get())) {
+        status["solve_us"] = mppi->stats.last_ns.load() / 1e3;
+        status["solve_max_us"] = mppi->stats.max_ns.load() / 1e3;
+        status["solve_deadline_us"] = mppi->deadline_ns() / 1e3;
+        status["solve_deadline_misses"] = mppi->stats.misses.load();
+      }
       std::string status_response = status.dump();
       http::response<http::string_body> res{http::status::ok, req.version()};
       res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
@@ -84,6 +170,10 @@ void CommServer::handle_request(tcp::socket &socket) {
     }
   }
   if (req.method() == http::verb::post) {
+    if (path == "/whatif") {
+      send_whatif(socket, req);
+      return;
+    }
     if (req.target() == "/pid") {
       json pid = json::parse(req.body());
       std::cout << "Received PID parameters: kp: " << pid["kp"]
@@ -153,3 +243,96 @@ void CommServer::handle_request(tcp::socket &socket) {
     return;
   }
 }
+
+void CommServer::send_trajectory(tcp::socket &socket,
+                                 const http::request<http::string_body> &req) {
+  std::uint64_t from = query_param(req.target(), "from", 0);
+  std::uint64_t max = query_param(req.target(), "max", SIZE_MAX);
+
+  std::vector<TelemetrySample> samples;
+  sim.m_telemetry.copy_since(from, samples, max);
+  if (accepts_telemetry(req)) {
+    send_telemetry(socket, req, samples);
+    return;
+  }
+
+  json trajectory = samples_to_json(samples);
+
+  http::response<http::string_body> res{http::status::ok, req.version()};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::content_type, "application/json");
+  res.set(http::field::vary, "Accept");
+  res.set(http::field::access_control_allow_origin, "*");
+  res.set(http::field::access_control_allow_methods, "GET, POST, OPTIONS");
+  res.keep_alive(req.keep_alive());
+  res.body() = trajectory.dump();
+  res.prepare_payload();
+  http::write(socket, res);
+}
+
+void CommServer::send_telemetry(tcp::socket &socket,
+                                const http::request<http::string_body> &req,
+                                const std::vector<TelemetrySample> &samples) {
+  http::response<http::string_body> res{http::status::ok, req.version()};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::content_type,
+          beast::string_view(telemetry_mime.data(), telemetry_mime.size()));
+  res.set(http::field::vary, "Accept");
+  res.set(http::field::access_control_allow_origin, "*");
+  res.set(http::field::access_control_allow_methods, "GET, POST, OPTIONS");
+  res.keep_alive(req.keep_alive());
+  res.body() = encode_telemetry(samples);
+  res.prepare_payload();
+  http::write(socket, res);
+}
+
+void CommServer::send_whatif(tcp::socket &socket,
+                             const http::request<http::string_body> &req) {
+  http::response<http::string_body> res{http::status::ok, req.version()};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::access_control_allow_origin, "*");
+  res.set(http::field::access_control_allow_methods, "GET, POST, OPTIONS");
+  res.keep_alive(req.keep_alive());
+
+  try {
+    json body = json::parse(req.body());
+    std::vector<WhatIfBranch> branches;
+    for (const auto &b : body.at("branches")) {
+      WhatIfBranch branch;
+      if (b.contains("kp") || b.contains("ki") || b.contains("kd")) {
+        branch.gains = {b.at("kp"), b.at("ki"), b.at("kd")};
+      }
+      if (b.contains("ref")) {
+        branch.ref_angle = b["ref"];
+      }
+      branches.push_back(branch);
+    }
+
+    auto sample_every = body.value("sample_every", std::int64_t{100});
+    if (sample_every < 1) {
+      throw std::invalid_argument("sample_every must be at least 1");
+    }
+    auto slots = whatif.run(sim, branches, body.value("horizon", 1.0),
+                            static_cast<std::uint64_t>(sample_every));
+
+    json result = json::array();
+    for (const auto &slot : slots) {
+      const WhatIfMetrics &m = slot.metrics;
+      result.push_back({{"metrics",
+                         {{"ise", m.ise},
+                          {"max_abs_error", m.max_abs_error},
+                          {"final_error", m.final_error},
+                          {"max_abs_x", m.max_abs_x},
+                          {"max_abs_force", m.max_abs_force}}},
+                        {"trajectory", samples_to_json(slot.trajectory)}});
+    }
+    res.set(http::field::content_type, "application/json");
+    res.body() = json{{"branches", std::move(result)}}.dump();
+  } catch (const std::exception &e) {
+    res.result(http::status::bad_request);
+    res.set(http::field::content_type, "text/plain");
+    res.body() = e.what();
+  }
+  res.prepare_payload();
+  http::write(socket, res);
+}
@@ -11,6 +11,7 @@
 
 #include "simulator.h"
 #include "controller.h"
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <experimental/random>
@@ -18,84 +19,101 @@
 #include <mutex>
 #include <thread>
 
+void SimState::reset() {
+  T = 0;
+  step = 0;
+  F = 0;
+  E = 0;
+  theta.fill(0);            // angle of pendulum with respect to vertical
+  theta.at(0) = M_PI_4 / 8; // starting angle
+
+  i = 0;
+  error = 0;
+
+  std::fill(q.begin(), q.end(), 0); // position of cart and link angles
+  std::fill(q_dot.begin(), q_dot.end(), 0);
+  std::fill(q_dot_dot.begin(), q_dot_dot.end(), 0);
+  q.at(1) = theta.at(0);
+}
+
+void advance(SimState &s, Controller &controller, const SimParams &params,
+             CartPendulumModel &model) {
+  ///@todo Implement delay and jitter by changing delay index based on
+  /// SimParams.delay and SimParams.jitter
+  int delay_index = s.i - 0; // delay of zero time step
+  ///@todo Handle case when delay index is negative, wrap around to end of
+  /// circular buffer
+  ///@todo Make sure delay index is within bounds of buffer size
+
+  s.error = params.ref_angle - s.theta.at(delay_index);
+  s.F = controller.output(s.q, s.q_dot, -s.error);
+
+  // new values for the state based on state of last time step
+  for (std::size_t k = 0; k < s.q.size(); ++k) {
+    s.q[k] += params.delta_t * s.q_dot[k];
+    s.q_dot[k] += params.delta_t * s.q_dot_dot[k];
+    if (k > 0 && std::abs(s.q[k]) > M_PI) {
+      s.q[k] -= (s.q[k] / std::abs(s.q[k])) * 2 * M_PI;
+    }
+  }
+  model.accelerations(s.q, s.q_dot, s.F, s.q_dot_dot);
+  s.E = model.energy(s.q, s.q_dot);
+
+  int j = (s.i + 1) % SimState::buffer_size;
+  s.theta.at(j) = s.q[1];
+  s.i = j;
+  s.T += params.delta_t;
+  ++s.step;
+}
+
 void Simulator::run_simulator() {
 
   if (!g_start) {
     std::unique_lock<std::mutex> lock(g_start_mutex);
     g_start_cv.wait(lock);
   }
-  int j = 0; // temp index
-  int delay_index = 0;
-  while (T < m_params.simulation_time) {
+  using clock = std::chrono::steady_clock;
+  const auto period = std::chrono::microseconds(200);
+  clock::time_point due{}; // when the next step should start, unset after a
+                           // pause since waiting is not latency
+  while (m_state.T < m_params.simulation_time) {
     if (g_pause) {
       std::unique_lock<std::mutex> lock(g_pause_mutex);
       g_pause_cv.wait(lock);
+      due = {};
     }
     {
       // parameters cannot be updated in the middle of time step
       std::lock_guard<std::mutex> lock(g_start_mutex);
 
-      ///@todo Implement delay and jitter by changing delay index based on
-      /// SimParams.delay and SimParams.jitter
-      delay_index = i - 0; // delay of zero time step
-      ///@todo Handle case when delay index is negative, wrap around to end of
-      /// circular buffer
-      ///@todo Make sure delay index is within bounds of buffer size
-
-      error = m_params.ref_angle - theta.at(delay_index);
-      F = m_controller->output(-error);
-
-      // new values for theata based on state of last time step
-      j = (i + 1) % buffer_size;
-      theta_dot[1] = theta_dot[0] + m_params.delta_t * theta_dot_dot[0];
-      theta.at(j) = theta.at(i) + m_params.delta_t * theta_dot[0];
-
-      if (std::abs(theta[j]) > M_PI) {
-        theta.at(j) =
-            theta.at(j) - (theta.at(j) / std::abs(theta.at(j))) * 2 * M_PI;
+      advance(m_state, *m_controller, m_params, m_model);
+      const SimState &s = m_state;
+      m_telemetry.record({s.step,
+                          {s.T, s.q[0], s.theta[s.i], s.q_dot[0], s.q_dot[1],
+                           s.q_dot_dot[0], s.q_dot_dot[1], s.F, s.E}});
+
+      // latency from when the step was due until it completed
+      if (due != clock::time_point{}) {
+        std::int64_t latency =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                                 due)
+                .count();
+        step_latency_last_ns = latency;
+        if (latency > step_latency_max_ns) {
+          step_latency_max_ns = latency;
+        }
       }
-
-      x_dot[1] = x_dot[0] + m_params.delta_t * x_dot_dot[0];
-      x[1] = x[0] + m_params.delta_t * x_dot[0];
-
-      A = c_ml * std::cos(theta.at(j));
-      b = c_ml * std::cos(theta.at(j));
-      C = -c_ml * std::pow(theta_dot[1], 2) * std::sin(theta.at(j)) - F;
-      c = c_ml * -1 * m_params.g * std::sin(theta[j]);
-
-      x_dot_dot[1] = (A * c - a * C) / (a * B - A * b);
-
-      theta_dot_dot[1] = -(c + b * x_dot_dot[1]) / a;
-
-      theta_dot[0] = theta_dot[1];
-      theta_dot_dot[0] = theta_dot_dot[1];
-
-      // new values for x based on state of last time step
-      x_dot[0] = x_dot[1];
-      x[0] = x[1];
-      x_dot_dot[0] = x_dot_dot[1];
-
-      T += m_params.delta_t;
-      i = j;
     }
-    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    due = clock::now() + period;
+    std::this_thread::sleep_for(period);
   }
 }
 void Simulator::reset_simulator() {
-  T = 0;
-  F = 0;
-  theta.fill(0);            // angle of pendulum with respect to vertical
-  theta.at(0) = M_PI_4 / 8; // starting angle
-  theta_dot = {0, 0};
-  theta_dot_dot = {0, 0};
-
-  i = 0;
-  error = 0;
-
-  x = {0, 0}; // position of cart
-  x_dot = {0, 0};
-  x_dot_dot = {0, 0};
+  m_state.reset();
   m_controller->reset();
+  m_telemetry.clear();
+  step_latency_last_ns = 0;
+  step_latency_max_ns = 0;
 }
 void Simulator::update_params(double ref = 0, int delay = 0, int jitter = 0) {
   ///@todo Implement update_params function to update simulation parameters
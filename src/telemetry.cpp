@@ -0,0 +1,308 @@
+/**
+ * @file telemetry.cpp
+ * @brief Implementation file for the TelemetryLog and the binary telemetry
+ * encoder and decoder.
+ *
+ * This file contains the ring buffer used to record the trajectory of the
+ * simulation and the predictive delta/XOR varint codec described in
+ * telemetry.h.
+ *
+ */
+
+#include "telemetry.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr std::string_view magic = "IPTM";
+constexpr std::uint8_t version = 1;
+
+void put_varint(std::string &out, std::uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<char>(v));
+}
+
+std::size_t varint_size(std::uint64_t v) {
+  return (std::bit_width(v | 1) + 6) / 7;
+}
+
+std::uint64_t zigzag(std::uint64_t d) {
+  return (d << 1) ^
+         static_cast<std::uint64_t>(static_cast<std::int64_t>(d) >> 63);
+}
+
+std::uint64_t unzigzag(std::uint64_t z) { return (z >> 1) ^ (~(z & 1) + 1); }
+
+/**
+ * @brief The last four bit patterns of a column, most recent first.
+ */
+using History = std::array<std::uint64_t, 4>;
+
+/// Extrapolates the next bit pattern from the history, exact for polynomials
+/// of degree order - 1. Wrapping arithmetic, the decoder inverts it exactly.
+std::uint64_t predict(const History &h, int order) {
+  switch (order) {
+  case 1:
+    return h[0];
+  case 2:
+    return 2 * h[0] - h[1];
+  case 3:
+    return 3 * h[0] - 3 * h[1] + h[2];
+  default:
+    return 4 * h[0] - 6 * h[1] + 4 * h[2] - h[3];
+  }
+}
+
+void push(History &h, std::uint64_t bits) {
+  h = {bits, h[0], h[1], h[2]};
+}
+
+/// Number of significant bytes of a nonzero XOR and its trailing zero bytes.
+std::pair<int, int> xor_bytes(std::uint64_t x) {
+  int trail = std::countr_zero(x) / 8;
+  return {8 - std::countl_zero(x) / 8 - trail, trail};
+}
+
+std::size_t value_size(TelemetryEncoding enc, const History &h,
+                       std::uint64_t cur) {
+  if (enc == TelemetryEncoding::Xor) {
+    std::uint64_t x = h[0] ^ cur;
+    return x == 0 ? 1 : 1 + xor_bytes(x).first;
+  }
+  return varint_size(zigzag(cur - predict(h, static_cast<int>(enc))));
+}
+
+void put_value(std::string &out, TelemetryEncoding enc, const History &h,
+               std::uint64_t cur) {
+  if (enc != TelemetryEncoding::Xor) {
+    put_varint(out, zigzag(cur - predict(h, static_cast<int>(enc))));
+    return;
+  }
+  std::uint64_t x = h[0] ^ cur;
+  if (x == 0) {
+    out.push_back(0);
+    return;
+  }
+  auto [len, trail] = xor_bytes(x);
+  out.push_back(static_cast<char>(trail << 4 | len));
+  x >>= 8 * trail;
+  for (int k = 0; k < len; ++k, x >>= 8) {
+    out.push_back(static_cast<char>(x & 0xff));
+  }
+}
+
+/**
+ * @brief Bounds checked reader over the encoded stream.
+ */
+struct Reader {
+  std::string_view data;
+  std::size_t pos = 0;
+
+  std::uint8_t byte() {
+    if (pos >= data.size()) {
+      throw std::runtime_error("telemetry: truncated stream");
+    }
+    return static_cast<std::uint8_t>(data[pos++]);
+  }
+
+  std::uint64_t varint() {
+    std::uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      std::uint8_t b = byte();
+      v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+        return v;
+      }
+    }
+    throw std::runtime_error("telemetry: varint overflow");
+  }
+
+  std::uint64_t value(TelemetryEncoding enc, const History &h) {
+    if (enc != TelemetryEncoding::Xor) {
+      return predict(h, static_cast<int>(enc)) + unzigzag(varint());
+    }
+    std::uint8_t ctrl = byte();
+    if (ctrl == 0) {
+      return h[0];
+    }
+    int trail = ctrl >> 4;
+    int len = ctrl & 0x0f;
+    if (len == 0 || trail + len > 8) {
+      throw std::runtime_error("telemetry: bad xor control byte");
+    }
+    std::uint64_t x = 0;
+    for (int k = 0; k < len; ++k) {
+      x |= static_cast<std::uint64_t>(byte()) << (8 * k);
+    }
+    return h[0] ^ (x << (8 * trail));
+  }
+};
+
+} // namespace
+
+TelemetryLog::TelemetryLog(std::size_t capacity) : samples(capacity) {}
+
+void TelemetryLog::record(const TelemetrySample &sample) {
+  std::lock_guard<std::mutex> lock(mutex);
+  samples[written % samples.size()] = sample;
+  ++written;
+}
+
+std::size_t TelemetryLog::copy_since(std::uint64_t from,
+                                     std::vector<TelemetrySample> &out,
+                                     std::size_t max_samples) const {
+  out.clear();
+  const std::uint64_t cap = samples.size();
+  std::uint64_t lo, hi, start_epoch;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto at = [&](std::uint64_t n) -> const TelemetrySample & {
+      return samples[n % cap];
+    };
+    // steps are recorded in increasing order, binary search the start
+    hi = written;
+    lo = hi - std::min(hi, cap);
+    std::uint64_t end = hi;
+    while (lo < end) {
+      std::uint64_t mid = lo + (end - lo) / 2;
+      if (at(mid).step < from) {
+        lo = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    if (hi - lo > max_samples) {
+      lo = hi - max_samples;
+    }
+    start_epoch = epoch;
+  }
+
+  out.reserve(hi - lo);
+  while (lo < hi) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (epoch != start_epoch) {
+      out.clear();
+      break;
+    }
+    // the recorder may have lapped the copy since the last chunk
+    lo = std::max(lo, written - std::min(written, cap));
+    std::uint64_t end = std::min<std::uint64_t>(hi, lo + copy_chunk);
+    for (; lo < end; ++lo) {
+      out.push_back(samples[lo % cap]);
+    }
+  }
+  return out.size();
+}
+
+void TelemetryLog::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  written = 0;
+  ++epoch;
+}
+
+std::string encode_telemetry(const std::vector<TelemetrySample> &samples) {
+  constexpr std::size_t encodings =
+      static_cast<std::size_t>(TelemetryEncoding::Delta4) + 1;
+
+  // sizing pass, every column gets the encoding with the smallest output
+  std::array<std::array<std::size_t, encodings>, telemetry_columns> size{};
+  std::array<History, telemetry_columns> hist{};
+  for (const auto &s : samples) {
+    for (std::size_t col = 0; col < telemetry_columns; ++col) {
+      auto bits = std::bit_cast<std::uint64_t>(s.values[col]);
+      for (std::size_t enc = 0; enc < encodings; ++enc) {
+        size[col][enc] +=
+            value_size(static_cast<TelemetryEncoding>(enc), hist[col], bits);
+      }
+      push(hist[col], bits);
+    }
+  }
+  std::array<TelemetryEncoding, telemetry_columns> column_encoding{};
+  std::size_t total = 0;
+  for (std::size_t col = 0; col < telemetry_columns; ++col) {
+    auto best = std::min_element(size[col].begin(), size[col].end());
+    column_encoding[col] =
+        static_cast<TelemetryEncoding>(best - size[col].begin());
+    total += *best;
+  }
+
+  std::string out;
+  out.reserve(64 + samples.size() * 2 + total);
+  out.append(magic);
+  out.push_back(static_cast<char>(version));
+  out.push_back(static_cast<char>(telemetry_columns));
+  for (std::size_t col = 0; col < telemetry_columns; ++col) {
+    out.push_back(static_cast<char>(column_encoding[col]));
+    out.push_back(static_cast<char>(telemetry_column_names[col].size()));
+    out.append(telemetry_column_names[col]);
+  }
+  put_varint(out, samples.size());
+
+  std::uint64_t prev_step = 0;
+  hist = {};
+  for (const auto &s : samples) {
+    put_varint(out, s.step - prev_step);
+    prev_step = s.step;
+    for (std::size_t col = 0; col < telemetry_columns; ++col) {
+      auto bits = std::bit_cast<std::uint64_t>(s.values[col]);
+      put_value(out, column_encoding[col], hist[col], bits);
+      push(hist[col], bits);
+    }
+  }
+  return out;
+}
+
+TelemetryTrace decode_telemetry(std::string_view data) {
+  Reader in{data};
+  if (data.substr(0, magic.size()) != magic) {
+    throw std::runtime_error("telemetry: bad magic");
+  }
+  in.pos = magic.size();
+  if (in.byte() != version) {
+    throw std::runtime_error("telemetry: unsupported version");
+  }
+
+  TelemetryTrace trace;
+  std::size_t ncols = in.byte();
+  std::vector<TelemetryEncoding> encodings(ncols);
+  for (std::size_t col = 0; col < ncols; ++col) {
+    std::uint8_t enc = in.byte();
+    if (enc > static_cast<std::uint8_t>(TelemetryEncoding::Delta4)) {
+      throw std::runtime_error("telemetry: unknown column encoding");
+    }
+    encodings[col] = static_cast<TelemetryEncoding>(enc);
+    std::size_t len = in.byte();
+    if (in.pos + len > data.size()) {
+      throw std::runtime_error("telemetry: truncated stream");
+    }
+    trace.columns.emplace_back(data.substr(in.pos, len));
+    in.pos += len;
+  }
+
+  std::uint64_t nsamples = in.varint();
+  // every sample takes at least one byte per column plus the step
+  if (nsamples > (data.size() - in.pos) / (ncols + 1)) {
+    throw std::runtime_error("telemetry: truncated stream");
+  }
+  trace.steps.reserve(nsamples);
+  trace.values.reserve(nsamples * ncols);
+
+  std::uint64_t step = 0;
+  std::vector<History> hist(ncols, History{});
+  for (std::uint64_t n = 0; n < nsamples; ++n) {
+    step += in.varint();
+    trace.steps.push_back(step);
+    for (std::size_t col = 0; col < ncols; ++col) {
+      std::uint64_t bits = in.value(encodings[col], hist[col]);
+      push(hist[col], bits);
+      trace.values.push_back(std::bit_cast<double>(bits));
+    }
+  }
+  return trace;
+}
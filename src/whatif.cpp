@@ -0,0 +1,158 @@
+/**
+ * @file whatif.cpp
+ * @brief Implementation file for the WhatIfEngine class.
+ *
+ * This file contains the snapshot of the live simulation, the worker pool
+ * running the branches and the computation of the branch metrics.
+ *
+ */
+
+#include "whatif.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+WhatIfEngine::WhatIfEngine(std::size_t workers, std::size_t max_branches,
+                           std::size_t max_samples, std::uint64_t max_work,
+                           const RealtimeConfig &placement)
+    : m_max_branches(max_branches), m_max_samples(max_samples),
+      m_max_work(max_work), m_slots(max_branches) {
+  for (auto &slot : m_slots) {
+    // resize rather than reserve, so that the pages are touched up front
+    slot.trajectory.resize(max_samples);
+    slot.trajectory.clear();
+  }
+  if (workers == 0) {
+    workers = worker_cpu_count(placement);
+  }
+  for (std::size_t k = 0; k < workers; ++k) {
+    m_workers.emplace_back([this, placement] {
+      place_worker_thread("whatif", placement);
+      worker();
+    });
+  }
+}
+
+WhatIfEngine::~WhatIfEngine() {
+  {
+    std::lock_guard<std::mutex> lock(m_work_mutex);
+    m_stop = true;
+  }
+  m_work_cv.notify_all();
+}
+
+std::span<const WhatIfEngine::Slot>
+WhatIfEngine::run(Simulator &sim, const std::vector<WhatIfBranch> &branches,
+                  double horizon, std::uint64_t sample_every) {
+  if (branches.size() > m_max_branches) {
+    throw std::invalid_argument("too many what-if branches");
+  }
+  std::lock_guard<std::mutex> query_lock(m_query_mutex);
+
+  {
+    // the live simulation only waits for this copy
+    std::lock_guard<std::mutex> lock(sim.g_start_mutex);
+    m_base.state = sim.m_state;
+    m_base.params = sim.m_params;
+    sim.m_controller->clone_into(m_base.controller);
+    if (m_base.model) {
+      *m_base.model = sim.m_model;
+    } else {
+      m_base.model = sim.m_model;
+    }
+  }
+
+  // queries block the server, bound their total work including the
+  // controller, computed as double so that huge horizons do not overflow
+  double horizon_steps = std::max(0.0, horizon) / m_base.params.delta_t;
+  double work = horizon_steps * static_cast<double>(branches.size()) *
+                (1 + m_base.controller->step_cost());
+  if (!(work <= static_cast<double>(m_max_work))) {
+    throw std::invalid_argument(
+        "what-if query exceeds " + std::to_string(m_max_work) +
+        " model evaluations (branches x steps x controller cost)");
+  }
+
+  for (std::size_t b = 0; b < branches.size(); ++b) {
+    Slot &slot = m_slots[b];
+    slot.state = m_base.state;
+    slot.params = m_base.params;
+    m_base.controller->clone_into(slot.controller);
+    if (slot.model) {
+      *slot.model = *m_base.model;
+    } else {
+      slot.model = *m_base.model;
+    }
+    slot.trajectory.clear();
+    slot.metrics = {};
+
+    const WhatIfBranch &branch = branches[b];
+    if (branch.gains) {
+      const auto &[kp, ki, kd] = *branch.gains;
+      slot.controller->update_params(kp, ki, kd);
+    }
+    if (branch.ref_angle) {
+      slot.params.ref_angle = *branch.ref_angle;
+    }
+  }
+
+  auto steps = static_cast<std::uint64_t>(horizon_steps);
+  sample_every = std::max<std::uint64_t>(
+      {sample_every, 1, (steps + m_max_samples - 1) / m_max_samples});
+
+  std::unique_lock<std::mutex> lock(m_work_mutex);
+  m_steps = steps;
+  m_sample_every = sample_every;
+  m_branches = branches.size();
+  m_next = 0;
+  m_done = 0;
+  ++m_generation;
+  m_work_cv.notify_all();
+  m_done_cv.wait(lock, [this] { return m_done == m_branches; });
+
+  return {m_slots.data(), branches.size()};
+}
+
+void WhatIfEngine::worker() {
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(m_work_mutex);
+  while (true) {
+    m_work_cv.wait(lock, [&] { return m_stop || m_generation != seen; });
+    if (m_stop) {
+      return;
+    }
+    seen = m_generation;
+    while (m_next < m_branches) {
+      Slot &slot = m_slots[m_next++];
+      std::uint64_t steps = m_steps, sample_every = m_sample_every;
+      lock.unlock();
+      run_branch(slot, steps, sample_every);
+      lock.lock();
+      if (++m_done == m_branches) {
+        m_done_cv.notify_one();
+      }
+    }
+  }
+}
+
+void WhatIfEngine::run_branch(Slot &slot, std::uint64_t steps,
+                              std::uint64_t sample_every) {
+  SimState &s = slot.state;
+  WhatIfMetrics &m = slot.metrics;
+  for (std::uint64_t n = 1; n <= steps; ++n) {
+    advance(s, *slot.controller, slot.params, *slot.model);
+
+    m.ise += s.error * s.error * slot.params.delta_t;
+    m.max_abs_error = std::max(m.max_abs_error, std::abs(s.error));
+    m.max_abs_x = std::max(m.max_abs_x, std::abs(s.q[0]));
+    m.max_abs_force = std::max(m.max_abs_force, std::abs(s.F));
+    if (n % sample_every == 0 && slot.trajectory.size() < m_max_samples) {
+      slot.trajectory.push_back(
+          {s.step,
+           {s.T, s.q[0], s.theta[s.i], s.q_dot[0], s.q_dot[1], s.q_dot_dot[0],
+            s.q_dot_dot[1], s.F, s.E}});
+    }
+  }
+  m.final_error = s.error;
+}
@@ -0,0 +1,79 @@
+#include "dynamics.h"
+#include <cmath>
+#include <gtest/gtest.h>
+
+TEST(DynamicsTest, SingleLinkMatchesClosedForm) {
+  // One link must reproduce the hand-derived cart-pendulum equations
+  Cart cart;
+  const Link &l = cart.links[0];
+  const double g = 9.81;
+  CartPendulumModel model(cart, g);
+
+  const double c_ml = l.m * l.len;
+  const double B = cart.M + l.m;
+  const double a = l.I + l.m * l.len * l.len;
+  for (double theta : {0.0, 0.3, -1.2, 2.5}) {
+    for (double theta_dot : {0.0, 1.5}) {
+      for (double F : {0.0, -3.0}) {
+        double A = c_ml * std::cos(theta);
+        double C = -c_ml * theta_dot * theta_dot * std::sin(theta) - F;
+        double c = -c_ml * g * std::sin(theta);
+        double x_dot_dot = (A * c - a * C) / (a * B - A * A);
+        double theta_dot_dot = -(c + A * x_dot_dot) / a;
+
+        double q[2] = {0.7, theta}, q_dot[2] = {-2.0, theta_dot};
+        double q_dot_dot[2];
+        model.accelerations(q, q_dot, F, q_dot_dot);
+        EXPECT_NEAR(q_dot_dot[0], x_dot_dot, 1e-12);
+        EXPECT_NEAR(q_dot_dot[1], theta_dot_dot, 1e-12);
+      }
+    }
+  }
+}
+
+TEST(DynamicsTest, TriplePendulumConservesEnergy) {
+  // Without external force the total energy of a chaotic triple pendulum
+  // must stay constant, integrated with RK4
+  Cart cart;
+  cart.links = {Link{}, Link{0.3, 0.4, 0.8}, Link{0.2, 0.25}};
+  CartPendulumModel model(cart, 9.81);
+  const std::size_t n = model.dof();
+
+  std::vector<double> x{0, 0.4, -0.3, 0.9, 0.5, 1.0, 0, -2.0};
+  std::vector<double> k[4], tmp(2 * n);
+  auto f = [&](const std::vector<double> &s, std::vector<double> &ds) {
+    ds.resize(2 * n);
+    std::copy(s.begin() + n, s.end(), ds.begin());
+    model.accelerations({s.data(), n}, {s.data() + n, n}, 0,
+                        {ds.data() + n, n});
+  };
+  auto stage = [&](double h, const std::vector<double> &ds) {
+    for (std::size_t r = 0; r < 2 * n; ++r) {
+      tmp[r] = x[r] + h * ds[r];
+    }
+  };
+
+  const double E0 = model.energy({x.data(), n}, {x.data() + n, n});
+  const double dt = 1e-4;
+  for (int step = 0; step < 20000; ++step) {
+    f(x, k[0]);
+    stage(dt / 2, k[0]);
+    f(tmp, k[1]);
+    stage(dt / 2, k[1]);
+    f(tmp, k[2]);
+    stage(dt, k[2]);
+    f(tmp, k[3]);
+    for (std::size_t r = 0; r < 2 * n; ++r) {
+      x[r] += dt / 6 * (k[0][r] + 2 * k[1][r] + 2 * k[2][r] + k[3][r]);
+    }
+  }
+  EXPECT_NEAR(model.energy({x.data(), n}, {x.data() + n, n}), E0, 1e-6);
+  // the links must actually have moved
+  EXPECT_GT(std::abs(x[3] - 0.9), 0.1);
+}
+
+TEST(DynamicsTest, RejectsCartWithoutLinks) {
+  Cart cart;
+  cart.links.clear();
+  EXPECT_THROW(CartPendulumModel(cart, 9.81), std::invalid_argument);
+}
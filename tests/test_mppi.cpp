@@ -0,0 +1,96 @@
+#include "mppi.h"
+#include "simulator.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(MPPITest, StabilizesPendulum) {
+  // Starting tilted, the pendulum must be brought upright and kept there
+  Cart cart;
+  SimParams params;
+  params.ref_angle = 0;
+  CartPendulumModel model(cart, params.g);
+  MPPIController controller(cart, params.delta_t, params.g);
+
+  SimState state(model.dof());
+  for (int n = 0; n < 20000; ++n) {
+    advance(state, controller, params, model);
+  }
+  EXPECT_LT(std::abs(state.q[1]), 0.05);
+  EXPECT_LT(std::abs(state.q[0]), 1.0);
+  // one solve per control period, deadline misses are counted among them
+  EXPECT_EQ(controller.stats.solves, 50u);
+  EXPECT_GT(controller.stats.max_ns, 0);
+  EXPECT_LE(controller.stats.misses, controller.stats.solves);
+}
+
+TEST(MPPITest, HoldsForceWithoutState) {
+  // The error alone is not enough to plan, the last force is held
+  Cart cart;
+  MPPIController controller(cart, 0.0001, 9.81);
+  std::array<double, 2> q{0, 0.2}, q_dot{0, 0};
+  double F = controller.output(q, q_dot, 0.2);
+  EXPECT_NE(F, 0);
+  EXPECT_EQ(controller.output(0.2), F);
+  controller.reset();
+  EXPECT_EQ(controller.output(0.2), 0);
+  EXPECT_EQ(controller.stats.solves, 0u);
+}
+
+TEST(MPPITest, ClampsForce) {
+  Cart cart;
+  MPPIController controller(cart, 0.0001, 9.81);
+  controller.setClamp(1, -1);
+  std::array<double, 2> q{0, 1.0}, q_dot{0, 0};
+  EXPECT_LE(std::abs(controller.output(q, q_dot, 1.0)), 1.0);
+}
+
+TEST(MPPITest, CloneCopiesPlan) {
+  // A clone continues with the same force sequence
+  Cart cart;
+  MPPIController controller(cart, 0.0001, 9.81);
+  std::array<double, 2> q{0, 0.2}, q_dot{0, 0};
+  double F = controller.output(q, q_dot, 0.2);
+  std::unique_ptr<Controller> copy;
+  controller.clone_into(copy);
+  EXPECT_EQ(copy->output(0.2), F);
+}
+
+TEST(MPPITest, SolvesInBackground) {
+  // The caller only hands off the state and picks up finished plans, a copy
+  // continues synchronously with the same force
+  Cart cart;
+  MPPIParams mppi;
+  mppi.background = true;
+  MPPIController controller(cart, 0.0001, 9.81, mppi);
+  std::array<double, 2> q{0, 0.2}, q_dot{0, 0};
+
+  double F = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (F == 0 && std::chrono::steady_clock::now() < deadline) {
+    F = controller.output(q, q_dot, 0.2);
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  EXPECT_NE(F, 0);
+  EXPECT_GE(controller.stats.solves, 1u);
+
+  std::unique_ptr<Controller> copy;
+  controller.clone_into(copy);
+  EXPECT_EQ(copy->output(0.2), F);
+  controller.reset();
+  EXPECT_EQ(controller.output(0.2), 0);
+}
+
+TEST(MPPITest, ResetDropsSolveInFlight) {
+  // A background solve started before reset() must not show up in the stats
+  Cart cart;
+  MPPIParams mppi;
+  mppi.background = true;
+  MPPIController controller(cart, 0.0001, 9.81, mppi);
+  std::array<double, 2> q{0, 0.2}, q_dot{0, 0};
+  controller.output(q, q_dot, 0.2);
+  controller.reset();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(controller.stats.solves, 0u);
+  EXPECT_EQ(controller.output(q, q_dot, 0.2), 0);
+}
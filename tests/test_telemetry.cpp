@@ -0,0 +1,132 @@
+#include "simulator.h"
+#include "telemetry.h"
+#include <gtest/gtest.h>
+#include <json.hpp>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+
+/**
+ * @brief Smooth full state feedback, so that no column of the trajectory
+ * stays constant.
+ */
+class StateFeedback : public Controller {
+public:
+  using Controller::output;
+  double output(double error) { return 0; }
+  double output(std::span<const double> q, std::span<const double> q_dot,
+                double error) {
+    return 150 * q[1] + 30 * q_dot[1] + 2 * q[0] + 5 * q_dot[0];
+  }
+  void update_params(double kp, double ki, double kd) {}
+  void reset() {}
+  void setClamp(double max, double min) {}
+  void clone_into(std::unique_ptr<Controller> &target) const {
+    target = std::make_unique<StateFeedback>(*this);
+  }
+};
+
+} // namespace
+
+TEST(TelemetryTest, RoundTrip) {
+  // Decoded stream must reproduce every step and value bit for bit
+  std::vector<TelemetrySample> samples;
+  for (std::uint64_t n = 1; n <= 1000; ++n) {
+    double t = n * 0.0001;
+    samples.push_back({n, {t, 0.5 * t, 0.1 - t, -1.0, 3.0 * t, 0.0, 1e-9, -t,
+                           0.0}});
+  }
+  samples.push_back({5000, {1.0, -0.0, 1e300, -1e-300, 0.1, 0.2, 0.3, 0.4,
+                            std::numeric_limits<double>::infinity()}});
+
+  TelemetryTrace trace = decode_telemetry(encode_telemetry(samples));
+  ASSERT_EQ(trace.columns.size(), telemetry_columns);
+  EXPECT_EQ(trace.columns[2], "theta");
+  ASSERT_EQ(trace.steps.size(), samples.size());
+  for (std::size_t row = 0; row < samples.size(); ++row) {
+    EXPECT_EQ(trace.steps[row], samples[row].step);
+    for (std::size_t col = 0; col < telemetry_columns; ++col) {
+      EXPECT_EQ(std::bit_cast<std::uint64_t>(trace.at(row, col)),
+                std::bit_cast<std::uint64_t>(samples[row].values[col]));
+    }
+  }
+}
+
+TEST(TelemetryTest, SmallerThanJson) {
+  // A simulated trajectory must take at most a tenth of the /trajectory JSON
+  StateFeedback controller;
+  SimParams params;
+  Cart cart;
+  CartPendulumModel model(cart, params.g);
+  SimState s(model.dof());
+  s.reset();
+
+  std::vector<TelemetrySample> samples;
+  json trajectory = json::array();
+  for (int n = 0; n < 20000; ++n) {
+    advance(s, controller, params, model);
+    samples.push_back({s.step,
+                       {s.T, s.q[0], s.theta[s.i], s.q_dot[0], s.q_dot[1],
+                        s.q_dot_dot[0], s.q_dot_dot[1], s.F, s.E}});
+    json j;
+    j["step"] = s.step;
+    for (std::size_t col = 0; col < telemetry_columns; ++col) {
+      j[std::string(telemetry_column_names[col])] =
+          samples.back().values[col];
+    }
+    trajectory.push_back(std::move(j));
+  }
+  std::size_t binary = encode_telemetry(samples).size();
+  std::size_t text = trajectory.dump().size();
+  EXPECT_GE(text, 10 * binary) << binary << " bytes vs " << text << " JSON";
+}
+
+TEST(TelemetryTest, RejectsTruncated) {
+  std::vector<TelemetrySample> samples{{1, {1, 2, 3, 4, 5, 6, 7, 8, 9}}};
+  std::string data = encode_telemetry(samples);
+  EXPECT_THROW(decode_telemetry(data.substr(0, data.size() - 1)),
+               std::runtime_error);
+  EXPECT_THROW(decode_telemetry("JSON"), std::runtime_error);
+}
+
+TEST(TelemetryTest, LogCopiesSinceStep) {
+  // Ring buffer keeps the most recent samples and honours from and max
+  TelemetryLog log(8);
+  for (std::uint64_t n = 1; n <= 20; ++n) {
+    log.record({n, {}});
+  }
+  std::vector<TelemetrySample> out;
+  EXPECT_EQ(log.copy_since(0, out), 8u);
+  EXPECT_EQ(out.front().step, 13u);
+  EXPECT_EQ(log.copy_since(18, out), 3u);
+  EXPECT_EQ(out.front().step, 18u);
+  EXPECT_EQ(log.copy_since(0, out, 1), 1u);
+  EXPECT_EQ(out.front().step, 20u);
+  log.clear();
+  EXPECT_EQ(log.copy_since(0, out), 0u);
+}
+
+TEST(TelemetryTest, LogCopiesAcrossChunks) {
+  // Copies longer than a chunk stay contiguous while recording continues
+  TelemetryLog log(4 * TelemetryLog::copy_chunk);
+  for (std::uint64_t n = 1; n <= 3 * TelemetryLog::copy_chunk; ++n) {
+    log.record({n, {}});
+  }
+  std::vector<TelemetrySample> out;
+  std::jthread recorder([&] {
+    for (std::uint64_t n = 3 * TelemetryLog::copy_chunk + 1;
+         n <= 6 * TelemetryLog::copy_chunk; ++n) {
+      log.record({n, {}});
+    }
+  });
+  log.copy_since(0, out);
+  recorder.join();
+  ASSERT_FALSE(out.empty());
+  for (std::size_t k = 1; k < out.size(); ++k) {
+    EXPECT_LT(out[k - 1].step, out[k].step);
+  }
+  EXPECT_EQ(log.copy_since(0, out), 4 * TelemetryLog::copy_chunk);
+  EXPECT_EQ(out.front().step, 2 * TelemetryLog::copy_chunk + 1);
+}
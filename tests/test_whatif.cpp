@@ -0,0 +1,62 @@
+#include "whatif.h"
+#include <gtest/gtest.h>
+
+TEST(WhatIfTest, BranchesLeaveLiveStateUntouched) {
+  // Forking must not advance or modify the live simulation
+  Simulator sim;
+  for (int n = 0; n < 1000; ++n) {
+    advance(sim.m_state, *sim.m_controller, sim.m_params, sim.m_model);
+  }
+  SimState before = sim.m_state;
+
+  WhatIfEngine engine(2, 4, 64);
+  std::vector<WhatIfBranch> branches(3);
+  branches[1].ref_angle = 0.3;
+  auto slots = engine.run(sim, branches, 0.5, 100);
+
+  EXPECT_EQ(sim.m_state.step, before.step);
+  EXPECT_EQ(sim.m_state.q, before.q);
+  ASSERT_EQ(slots.size(), 3u);
+  for (const auto &slot : slots) {
+    EXPECT_EQ(slot.state.step, before.step + 5000);
+    EXPECT_EQ(slot.trajectory.size(), 50u);
+  }
+  EXPECT_NE(slots[0].metrics.ise, slots[1].metrics.ise);
+}
+
+TEST(WhatIfTest, RepeatedQueriesAreDeterministic) {
+  // Identical branches give identical predictions, also across queries
+  Simulator sim;
+  WhatIfEngine engine(2, 4, 64);
+  std::vector<WhatIfBranch> branches(2);
+
+  auto first = engine.run(sim, branches, 0.2, 10);
+  std::vector<double> q = first[0].state.q;
+  EXPECT_EQ(first[1].state.q, q);
+
+  auto second = engine.run(sim, branches, 0.2, 10);
+  EXPECT_EQ(second[0].state.q, q);
+  // horizon is capped to the trajectory capacity by sampling less often
+  auto long_run = engine.run(sim, branches, 1.0, 1);
+  EXPECT_LE(long_run[0].trajectory.size(), 64u);
+}
+
+TEST(WhatIfTest, RejectsTooManyBranches) {
+  Simulator sim;
+  WhatIfEngine engine(1, 2, 8);
+  std::vector<WhatIfBranch> branches(3);
+  EXPECT_THROW(engine.run(sim, branches, 0.1, 1), std::invalid_argument);
+}
+
+TEST(WhatIfTest, RejectsTooMuchWork) {
+  // Branches times steps is bounded so that a query cannot stall the server
+  Simulator sim;
+  WhatIfEngine engine(1, 2, 8, 1000);
+  std::vector<WhatIfBranch> branches(1);
+  EXPECT_THROW(engine.run(sim, branches, 1e6, 1), std::invalid_argument);
+  EXPECT_THROW(engine.run(sim, branches, 0.2, 1), std::invalid_argument);
+  EXPECT_EQ(engine.run(sim, branches, 0.1, 1)[0].state.step, 1000u);
+  branches.resize(2);
+  EXPECT_THROW(engine.run(sim, branches, 0.1, 1), std::invalid_argument);
+  EXPECT_EQ(engine.run(sim, branches, 0.05, 1)[1].state.step, 500u);
+}